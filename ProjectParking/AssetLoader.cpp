@@ -0,0 +1,106 @@
+#include "AssetLoader.h"
+#include "Profiler.h"
+#include <algorithm>
+
+AssetLoader::AssetLoader(RenderBackend& backend, TextureAtlas& atlas, TaskPool& pool, const AssetPack* pack) : backend(backend), atlas(atlas), pool(pool), pack(pack), pending(0), runningTasks(0), stopping(false) {
+    // 1x1 transparent texture shown while an image is still decoding
+    unsigned char transparent[4] = { 0, 0, 0, 0 };
+    const unsigned char* level = transparent;
+    TextureDesc desc = { TextureFormat::RGBA, 1, 1, 1, 0, true };
+    placeholder = backend.createTexture();
+    backend.uploadTexture(placeholder, desc, &level);
+}
+
+AssetLoader::~AssetLoader() {
+    {
+        // The tasks point at the loader, so it has to outlive them
+        std::unique_lock<std::mutex> lock(mutex);
+        stopping = true;
+        taskDone.wait(lock, [this]() { return runningTasks == 0; });
+    }
+
+    for (Result& result : results) {
+        delete result.texture;
+    }
+    backend.deleteTexture(placeholder);
+}
+
+int AssetLoader::loadImage(const std::string& path) {
+    int handle = static_cast<int>(regions.size());
+    regions.push_back(TextureRegion(placeholder));
+    ready.push_back(false);
+    pending++;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        runningTasks++;
+    }
+    pool.submit([this, handle, path]() { load(handle, path); });
+    return handle;
+}
+
+const TextureRegion& AssetLoader::getRegion(int handle) const {
+    return regions[handle];
+}
+
+bool AssetLoader::isReady(int handle) const {
+    return ready[handle];
+}
+
+bool AssetLoader::isIdle() const {
+    return pending == 0;
+}
+
+int AssetLoader::update() {
+    std::vector<Result> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.swap(results);
+    }
+    if (finished.empty()) {
+        return 0;
+    }
+    PROFILE_SCOPE("upload images");
+
+    // Pack in handle order so the atlas layout doesn't depend on which worker finished first
+    std::sort(finished.begin(), finished.end(), [](const Result& a, const Result& b) { return a.handle < b.handle; });
+
+    for (Result& result : finished) {
+        if (result.texture) {
+            BakedTexture& texture = *result.texture;
+            regions[result.handle] = atlas.addMipmapped(texture.getLevels(), texture.getLevelCount(), texture.getWidth(), texture.getHeight());
+            delete result.texture;
+        }
+        ready[result.handle] = true;
+        pending--;
+    }
+    atlas.upload();
+
+    return static_cast<int>(finished.size());
+}
+
+void AssetLoader::load(int handle, const std::string& path) {
+    bool skip;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        skip = stopping;
+    }
+
+    if (!skip) {
+        PROFILE_SCOPE("load image");
+        Result result = { handle, new BakedTexture() };
+        bool packed = pack && pack->isOpen() && pack->loadTexture(path, *result.texture);
+        if (!packed && !result.texture->load(path)) {
+            std::cerr << "ERROR::ASSET_LOADER: Failed to load image: " << path << std::endl;
+            delete result.texture;
+            result.texture = nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(result);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    runningTasks--;
+    taskDone.notify_all();
+}
@@ -0,0 +1,58 @@
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "AssetPack.h"
+#include "Rendering.h"
+#include "TaskPool.h"
+#include "TextureCache.h"
+
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+// Loads images as tasks on the thread pool, from the baked texture cache when it is up to date.
+// The render thread packs the pixels into the atlas in update(), until then a handle shows a transparent placeholder.
+class AssetLoader {
+public:
+    // Images are taken from the pack when it is open and has them
+    AssetLoader(RenderBackend& backend, TextureAtlas& atlas, TaskPool& pool, const AssetPack* pack = nullptr);
+    // Waits for the loads already running, the queued ones are skipped
+    ~AssetLoader();
+
+    // Queues the image for decoding and returns its handle right away
+    int loadImage(const std::string& path);
+    const TextureRegion& getRegion(int handle) const;
+    bool isReady(int handle) const;
+    bool isIdle() const;
+
+    // Uploads the images decoded since the last call and returns how many became ready.
+    // Must run on the render thread outside a frame, the atlas upload binds textures.
+    int update();
+
+private:
+    struct Result {
+        int handle;
+        // Null when the image failed to load
+        BakedTexture* texture;
+    };
+
+    RenderBackend& backend;
+    TextureAtlas& atlas;
+    TaskPool& pool;
+    const AssetPack* pack;
+    GLuint placeholder;
+    std::vector<TextureRegion> regions;
+    std::vector<bool> ready;
+    int pending;
+
+    std::mutex mutex;
+    std::condition_variable taskDone;
+    // Tasks submitted to the pool that haven't finished
+    int runningTasks;
+    std::vector<Result> results;
+    bool stopping;
+
+    void load(int handle, const std::string& path);
+};
+
+#endif
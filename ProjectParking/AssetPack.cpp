@@ -0,0 +1,134 @@
+#include "AssetPack.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char PACK_MAGIC[4] = { 'P', 'P', 'A', 'K' };
+
+static bool getAssetType(const std::string& name, AssetType& type) {
+    std::string extension = name.substr(name.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    if (extension == "otf" || extension == "ttf") {
+        type = AssetType::Font;
+    }
+    else if (extension == "png" || extension == "jpg" || extension == "jpeg") {
+        type = AssetType::Texture;
+    }
+    else if (extension == "wav" || extension == "ogg" || extension == "mp3") {
+        type = AssetType::Sound;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+AssetPack::AssetPack() : entries(nullptr), entryCount(0) {
+}
+
+bool AssetPack::open(const std::string& path) {
+    if (!mapping.open(path)) {
+        return false;
+    }
+
+    const AssetPackHeader* header = reinterpret_cast<const AssetPackHeader*>(mapping.getData());
+    bool valid = mapping.getSize() >= sizeof(AssetPackHeader) &&
+        memcmp(header->magic, PACK_MAGIC, 4) == 0 &&
+        header->version == VERSION &&
+        sizeof(AssetPackHeader) + header->entryCount * sizeof(AssetPackEntry) <= mapping.getSize();
+
+    if (valid) {
+        entries = reinterpret_cast<const AssetPackEntry*>(mapping.getData() + sizeof(AssetPackHeader));
+        entryCount = header->entryCount;
+        for (uint32_t i = 0; valid && i < entryCount; ++i) {
+            valid = entries[i].offset + entries[i].size <= mapping.getSize();
+        }
+    }
+
+    if (!valid) {
+        std::cerr << "ERROR::ASSET_PACK: Invalid asset pack: " << path << std::endl;
+        mapping.close();
+        entries = nullptr;
+        entryCount = 0;
+        return false;
+    }
+    return true;
+}
+
+bool AssetPack::find(const std::string& name, AssetType type, const unsigned char*& data, size_t& size) const {
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        if (entries[i].type == type && strncmp(entries[i].name, name.c_str(), sizeof(entries[i].name)) == 0) {
+            data = mapping.getData() + entries[i].offset;
+            size = static_cast<size_t>(entries[i].size);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AssetPack::loadTexture(const std::string& name, BakedTexture& texture) const {
+    const unsigned char* data;
+    size_t size;
+    return find(name, AssetType::Texture, data, size) && texture.loadFromMemory(data, size);
+}
+
+bool AssetPack::build(const std::string& packPath, const std::vector<std::string>& files) {
+    std::vector<AssetPackEntry> table(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        memset(&table[i], 0, sizeof(AssetPackEntry));
+        if (files[i].size() >= sizeof(table[i].name) || !getAssetType(files[i], table[i].type)) {
+            std::cerr << "ERROR::ASSET_PACK: Cannot pack " << files[i] << std::endl;
+            return false;
+        }
+        memcpy(table[i].name, files[i].c_str(), files[i].size());
+    }
+
+    std::ofstream out(packPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "ERROR::ASSET_PACK: Failed to create " << packPath << std::endl;
+        return false;
+    }
+
+    AssetPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = VERSION;
+    header.entryCount = static_cast<uint32_t>(table.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // The index is written again once the blob offsets are known
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(AssetPackEntry));
+
+    static const char zeros[BLOB_ALIGNMENT] = {};
+    for (size_t i = 0; i < files.size(); ++i) {
+        size_t position = static_cast<size_t>(out.tellp());
+        size_t aligned = (position + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+        out.write(zeros, aligned - position);
+        table[i].offset = aligned;
+
+        bool written;
+        if (table[i].type == AssetType::Texture) {
+            BakedTexture texture;
+            written = texture.load(files[i]) && texture.write(out);
+        }
+        else {
+            std::ifstream in(files[i], std::ios::binary);
+            written = static_cast<bool>(in);
+            if (written) {
+                out << in.rdbuf();
+            }
+        }
+
+        if (!written || !out) {
+            std::cerr << "ERROR::ASSET_PACK: Failed to pack " << files[i] << std::endl;
+            return false;
+        }
+        table[i].size = static_cast<size_t>(out.tellp()) - aligned;
+    }
+
+    out.seekp(sizeof(AssetPackHeader));
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(AssetPackEntry));
+    return static_cast<bool>(out);
+}
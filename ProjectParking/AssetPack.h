@@ -0,0 +1,58 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "TextureCache.h"
+
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+enum class AssetType : uint32_t {
+    Font = 1,
+    // Baked texture in the texture cache layout, used straight from the mapping
+    Texture = 2,
+    Sound = 3
+};
+
+// Pack layout: the header, the index table, then the asset blobs on aligned offsets
+struct AssetPackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct AssetPackEntry {
+    char name[56];
+    AssetType type;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// All fonts, images and sounds in one memory-mapped file. The mapping stays open as long as
+// the pack exists, so anything loaded from it may keep pointing into it.
+class AssetPack {
+public:
+    static const uint32_t VERSION = 1;
+    static const size_t BLOB_ALIGNMENT = 64;
+
+    AssetPack();
+
+    bool open(const std::string& path);
+    bool isOpen() const { return mapping.isOpen(); }
+
+    // Data of the named asset inside the mapping, false when the pack has no such asset of that type
+    bool find(const std::string& name, AssetType type, const unsigned char*& data, size_t& size) const;
+    bool loadTexture(const std::string& name, BakedTexture& texture) const;
+
+    // Writes a pack with the given files, the type comes from the extension and images are stored baked
+    static bool build(const std::string& packPath, const std::vector<std::string>& files);
+
+private:
+    MappedFile mapping;
+    const AssetPackEntry* entries;
+    uint32_t entryCount;
+};
+
+#endif
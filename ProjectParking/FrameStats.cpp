@@ -0,0 +1,201 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+static const char* PHASE_NAMES[FRAME_PHASE_COUNT] = { "update", "render", "swap", "sleep", "frame" };
+
+FrameTimeHistogram::FrameTimeHistogram() : counts(BUCKET_COUNT, 0), count(0), max(0) {
+}
+
+// Exact below the sub-bucket count, above it the top bits pick the bucket within the value's power of two
+int FrameTimeHistogram::getBucket(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<int>(value);
+    }
+
+    int highestBit = 0;
+    while ((value >> (highestBit + 1)) != 0) {
+        highestBit++;
+    }
+    int shift = highestBit - (SUB_BUCKET_BITS - 1);
+    int subBucket = static_cast<int>(value >> shift);
+    return SUB_BUCKET_COUNT + (shift - 1) * HALF_BUCKET_COUNT + (subBucket - HALF_BUCKET_COUNT);
+}
+
+uint64_t FrameTimeHistogram::getBucketTop(int bucket) {
+    if (bucket < SUB_BUCKET_COUNT) {
+        return bucket;
+    }
+
+    int shift = (bucket - SUB_BUCKET_COUNT) / HALF_BUCKET_COUNT + 1;
+    uint64_t subBucket = (bucket - SUB_BUCKET_COUNT) % HALF_BUCKET_COUNT + HALF_BUCKET_COUNT;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+void FrameTimeHistogram::record(uint64_t microseconds) {
+    microseconds = std::min<uint64_t>(microseconds, UINT32_MAX);
+    counts[getBucket(microseconds)]++;
+    count++;
+    max = std::max(max, microseconds);
+}
+
+void FrameTimeHistogram::clear() {
+    std::fill(counts.begin(), counts.end(), 0);
+    count = 0;
+    max = 0;
+}
+
+uint64_t FrameTimeHistogram::getPercentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(std::min(std::max(percentile, 0.0), 100.0) / 100.0 * count));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return std::min(getBucketTop(bucket), max);
+        }
+    }
+    return max;
+}
+
+FrameStats::FrameStats() : history(HISTORY_LENGTH), historyNext(0), lastIssued(0), lastAvoided(0), totalIssued(0), totalAvoided(0), stateFrames(0) {
+}
+
+void FrameStats::record(const FrameTimes& times) {
+    const double phases[FRAME_PHASE_COUNT] = { times.update, times.render, times.swap, times.sleep, times.frame };
+    for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+        histograms[phase].record(static_cast<uint64_t>(std::max(phases[phase], 0.0) * 1000.0 + 0.5));
+    }
+
+    history[historyNext % HISTORY_LENGTH] = times;
+    historyNext++;
+}
+
+void FrameStats::recordStateChanges(unsigned int issued, unsigned int avoided) {
+    lastIssued = issued;
+    lastAvoided = avoided;
+    totalIssued += issued;
+    totalAvoided += avoided;
+    stateFrames++;
+}
+
+const FrameTimeHistogram& FrameStats::getHistogram(FramePhase phase) const {
+    return histograms[static_cast<int>(phase)];
+}
+
+void FrameStats::clear() {
+    for (FrameTimeHistogram& histogram : histograms) {
+        histogram.clear();
+    }
+    std::fill(history.begin(), history.end(), FrameTimes());
+    historyNext = 0;
+    lastIssued = 0;
+    lastAvoided = 0;
+    totalIssued = 0;
+    totalAvoided = 0;
+    stateFrames = 0;
+}
+
+void FrameStats::print(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+
+    out << std::left << std::setw(10) << "phase" << std::right << std::setw(10) << "frames"
+        << std::setw(10) << "p50 ms" << std::setw(10) << "p95 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << "\n";
+    out << std::fixed << std::setprecision(3);
+    for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase) {
+        const FrameTimeHistogram& histogram = histograms[phase];
+        if (histogram.getMax() == 0) {
+            continue;
+        }
+        out << std::left << std::setw(10) << PHASE_NAMES[phase] << std::right << std::setw(10) << histogram.getCount()
+            << std::setw(10) << histogram.getPercentile(50.0) / 1000.0
+            << std::setw(10) << histogram.getPercentile(95.0) / 1000.0
+            << std::setw(10) << histogram.getPercentile(99.0) / 1000.0
+            << std::setw(10) << histogram.getMax() / 1000.0 << "\n";
+    }
+    if (stateFrames > 0) {
+        out << std::setprecision(1) << "GL state changes per frame: " << static_cast<double>(totalIssued) / stateFrames << " issued, "
+            << static_cast<double>(totalAvoided) / stateFrames << " avoided\n";
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void FrameStats::drawHud(Renderer& renderer, float x, float y, double budgetMs) const {
+    const float barWidth = 1.5f;
+    const float graphHeight = 100.0f;
+    const float lineHeight = 16.0f;
+    const float padding = 6.0f;
+    // Frames up to twice the budget fit, longer ones are cut off at the top
+    const float pixelsPerMs = static_cast<float>(graphHeight / (budgetMs * 2.0));
+    const float graphWidth = HISTORY_LENGTH * barWidth;
+    const int phaseLines = 4;
+    // The state changes go below the phases once there are any
+    const int textLines = stateFrames > 0 ? phaseLines + 1 : phaseLines;
+
+    const float backgroundColor[4] = { 0.0f, 0.0f, 0.0f, 0.6f };
+    const float frameColor[4] = { 0.6f, 0.15f, 0.15f, 0.8f };
+    const float phaseColors[3][4] = {
+        { 0.3f, 0.6f, 1.0f, 0.9f },
+        { 0.3f, 0.9f, 0.4f, 0.9f },
+        { 1.0f, 0.8f, 0.2f, 0.9f }
+    };
+    const float budgetColor[4] = { 1.0f, 1.0f, 1.0f, 0.7f };
+
+    renderer.beginRectangles();
+    renderer.submitRectangle(x, y, graphWidth + padding * 2.0f, graphHeight + textLines * lineHeight + padding * 3.0f, backgroundColor);
+
+    // Oldest frame on the left
+    size_t frames = std::min(historyNext, static_cast<size_t>(HISTORY_LENGTH));
+    for (size_t i = 0; i < frames; ++i) {
+        const FrameTimes& times = history[(historyNext - frames + i) % HISTORY_LENGTH];
+        float barX = x + padding + (HISTORY_LENGTH - frames + i) * barWidth;
+
+        renderer.submitRectangle(barX, y + padding, barWidth, std::min(static_cast<float>(times.frame) * pixelsPerMs, graphHeight), frameColor);
+
+        const double phases[3] = { times.update, times.render, times.swap };
+        float barY = 0.0f;
+        for (int phase = 0; phase < 3 && barY < graphHeight; ++phase) {
+            float height = std::min(static_cast<float>(phases[phase]) * pixelsPerMs, graphHeight - barY);
+            renderer.submitRectangle(barX, y + padding + barY, barWidth, height, phaseColors[phase]);
+            barY += height;
+        }
+    }
+    renderer.submitRectangle(x + padding, y + padding + static_cast<float>(budgetMs) * pixelsPerMs, graphWidth, 1.0f, budgetColor);
+    renderer.flushRectangles();
+
+    // Percentiles over the whole run, the frame on top
+    const FramePhase shownPhases[phaseLines] = { FramePhase::Frame, FramePhase::Update, FramePhase::Render, FramePhase::Swap };
+    const glm::vec4 textColors[phaseLines] = {
+        glm::vec4(1.0f),
+        glm::vec4(phaseColors[0][0], phaseColors[0][1], phaseColors[0][2], 1.0f),
+        glm::vec4(phaseColors[1][0], phaseColors[1][1], phaseColors[1][2], 1.0f),
+        glm::vec4(phaseColors[2][0], phaseColors[2][1], phaseColors[2][2], 1.0f)
+    };
+    renderer.beginText();
+    for (int line = 0; line < phaseLines; ++line) {
+        const FrameTimeHistogram& histogram = getHistogram(shownPhases[line]);
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(1) << PHASE_NAMES[static_cast<int>(shownPhases[line])]
+            << "  p50 " << histogram.getPercentile(50.0) / 1000.0
+            << "  p95 " << histogram.getPercentile(95.0) / 1000.0
+            << "  p99 " << histogram.getPercentile(99.0) / 1000.0
+            << "  max " << histogram.getMax() / 1000.0 << " ms";
+        float textY = y + padding * 2.0f + graphHeight + (textLines - 1 - line) * lineHeight;
+        renderer.submitText(text.str(), x + padding, textY, 0.3f, textColors[line]);
+    }
+    if (stateFrames > 0) {
+        std::ostringstream text;
+        text << "GL state  " << lastIssued << " issued  " << lastAvoided << " avoided";
+        renderer.submitText(text.str(), x + padding, y + padding * 2.0f + graphHeight, 0.3f, glm::vec4(1.0f));
+    }
+    renderer.flushText();
+}
@@ -0,0 +1,87 @@
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "Rendering.h"
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+// Log-linear histogram of durations in microseconds, in the manner of HdrHistogram with two significant digits:
+// exact below 128 us, then 64 buckets per power of two, so a reported value is at most 1.6% above the real one.
+class FrameTimeHistogram {
+public:
+    FrameTimeHistogram();
+
+    void record(uint64_t microseconds);
+    void clear();
+
+    uint64_t getCount() const { return count; }
+    uint64_t getMax() const { return max; }
+    // Top of the bucket holding the percentile (0..100), never above the largest value seen. 0 when empty.
+    uint64_t getPercentile(double percentile) const;
+
+private:
+    static const int SUB_BUCKET_BITS = 7;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int HALF_BUCKET_COUNT = SUB_BUCKET_COUNT / 2;
+    // Covers every 32-bit duration, a bit over an hour
+    static const int BUCKET_COUNT = SUB_BUCKET_COUNT + (32 - SUB_BUCKET_BITS) * HALF_BUCKET_COUNT;
+
+    std::vector<uint32_t> counts;
+    uint64_t count;
+    uint64_t max;
+
+    static int getBucket(uint64_t value);
+    static uint64_t getBucketTop(int bucket);
+};
+
+enum class FramePhase {
+    Update,
+    Render,
+    Swap,
+    Sleep,
+    // The whole loop iteration, sleep included
+    Frame
+};
+
+const int FRAME_PHASE_COUNT = 5;
+
+// Durations of one frame's phases in milliseconds
+struct FrameTimes {
+    double update = 0.0;
+    double render = 0.0;
+    double swap = 0.0;
+    double sleep = 0.0;
+    double frame = 0.0;
+};
+
+// Histograms of every phase over the whole run, and the last frames for the on-screen graph
+class FrameStats {
+public:
+    static const int HISTORY_LENGTH = 240;
+
+    FrameStats();
+
+    void record(const FrameTimes& times);
+    // GL state changes of the last frame, sent to GL and skipped as redundant by the state cache
+    void recordStateChanges(unsigned int issued, unsigned int avoided);
+    const FrameTimeHistogram& getHistogram(FramePhase phase) const;
+    void clear();
+
+    // p50/p95/p99/max per phase in milliseconds, phases that never took any time are left out
+    void print(std::ostream& out) const;
+    // Graph of the recent frames with the work phases stacked over the whole frame, the budget as a line
+    // across it, the percentiles of the phases above and the last frame's state changes below them.
+    // x and y are the lower left corner.
+    void drawHud(Renderer& renderer, float x, float y, double budgetMs) const;
+
+private:
+    FrameTimeHistogram histograms[FRAME_PHASE_COUNT];
+    std::vector<FrameTimes> history;
+    size_t historyNext;
+    unsigned int lastIssued, lastAvoided;
+    uint64_t totalIssued, totalAvoided;
+    uint64_t stateFrames;
+};
+
+#endif
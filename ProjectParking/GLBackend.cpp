@@ -0,0 +1,832 @@
+#include "GLBackend.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// number conversion warnings
+#pragma warning(disable : 4244)
+
+const char* textVertexShaderSource = R"(
+    #version 330 core
+
+    layout (location = 0) in vec4 vertex;
+    layout (location = 1) in vec4 aColor;
+    out vec2 TexCoords;
+    out vec4 TextColor;
+    
+    layout (std140) uniform Matrices {
+        mat4 projection;
+    };
+    
+    void main() {
+        gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+        TexCoords = vertex.zw;
+        TextColor = aColor;
+    }
+)";
+
+const char* textFragmentShaderSource = R"(
+    #version 330 core
+
+    in vec2 TexCoords;
+    in vec4 TextColor;
+    out vec4 color;
+    
+    uniform sampler2D text;
+    
+    void main() {
+        vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
+        color = TextColor * sampled;
+    }
+)";
+
+const char* sdfTextFragmentShaderSource = R"(
+    #version 330 core
+
+    in vec2 TexCoords;
+    in vec4 TextColor;
+    out vec4 color;
+    
+    uniform sampler2D text;
+    
+    void main() {
+        // The glyph outline is where the distance crosses 0.5, smooth over one screen pixel
+        float dist = texture(text, TexCoords).r;
+        float width = max(fwidth(dist), 0.0001);
+        float alpha = smoothstep(0.5 - width, 0.5 + width, dist);
+        color = vec4(TextColor.rgb, TextColor.a * alpha);
+    }
+)";
+
+const char* vertexShaderSource = R"(
+    #version 330 core
+
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in vec4 aColor;
+    
+    layout (std140) uniform Matrices {
+        mat4 projection;
+    };
+    
+    out vec4 fragColor;
+    
+    void main() {
+        gl_Position = projection * vec4(aPos.x, aPos.y, 0.0, 1.0);
+        fragColor = aColor;
+    }
+)";
+
+const char* fragmentShaderSource = R"(
+    #version 330 core
+
+    in vec4 fragColor;
+    out vec4 FragColor;
+    
+    void main() {
+        FragColor = fragColor;
+    }
+)";
+
+const char* circleVertexShaderSource = R"(
+    #version 330 core
+
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in vec3 aCircle;
+    layout (location = 2) in vec4 aColor;
+
+    layout (std140) uniform Matrices {
+        mat4 projection;
+    };
+
+    out vec4 fragColor;
+
+    void main() {
+        gl_Position = projection * vec4(aCircle.xy + aPos * aCircle.z, 0.0, 1.0);
+        fragColor = aColor;
+    }
+)";
+
+const char* timerVertexShaderSource = R"(
+    #version 330 core
+
+    layout (location = 0) in vec2 aPos;
+    layout (location = 1) in vec4 aTimer;
+
+    layout (std140) uniform Matrices {
+        mat4 projection;
+    };
+
+    out vec2 Local;
+    out float Radius;
+    out float RedProgress;
+
+    void main() {
+        // Cover the circle plus one pixel for the anti-aliased rim, empty records collapse to a point
+        float extent = aTimer.z > 0.0 ? aTimer.z + 1.0 : 0.0;
+        Local = (aPos * 2.0 - 1.0) * extent;
+        Radius = aTimer.z;
+        RedProgress = aTimer.w;
+        gl_Position = projection * vec4(aTimer.xy + Local, 0.0, 1.0);
+    }
+)";
+
+const char* timerFragmentShaderSource = R"(
+    #version 330 core
+
+    in vec2 Local;
+    in float Radius;
+    in float RedProgress;
+    out vec4 FragColor;
+
+    const float PI = 3.14159265358979323846;
+
+    void main() {
+        float dist = length(Local);
+        float aa = max(fwidth(dist), 0.0001);
+        float coverage = clamp((Radius - dist) / aa + 0.5, 0.0, 1.0);
+        if (coverage <= 0.0) {
+            discard;
+        }
+
+        // Green runs counter-clockwise from the top, red fills the rest
+        float angle = mod(atan(Local.y, Local.x) - PI / 2.0 + 2.0 * PI, 2.0 * PI);
+        float split = (1.0 - RedProgress) * 2.0 * PI;
+
+        float green;
+        if (RedProgress <= 0.0) {
+            green = 1.0;
+        }
+        else if (RedProgress >= 1.0) {
+            green = 0.0;
+        }
+        else {
+            // Pixel distances to the two color boundaries, measured along the arc
+            float insideGreen = min(split - angle, angle) * dist / aa;
+            float pastStart = (2.0 * PI - angle) * dist / aa;
+            green = max(clamp(insideGreen + 0.5, 0.0, 1.0), clamp(0.5 - pastStart, 0.0, 1.0));
+        }
+
+        FragColor = vec4(mix(vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), green), coverage);
+    }
+)";
+
+const char* imageVertexShaderSource = R"(
+	#version 330 core
+
+	layout (location = 0) in vec2 aPos;
+	layout (location = 1) in vec4 aRect;
+	layout (location = 2) in vec4 aTexRect;
+	layout (location = 3) in vec2 aRotationAlpha;
+	layout (location = 4) in vec3 aBlendColor;
+
+	out vec2 TexCoords;
+	out float Alpha;
+	out vec3 BlendColor;
+
+    layout (std140) uniform Matrices {
+        mat4 projection;
+    };
+
+	void main() {
+		// Scale the unit quad and rotate it around its center
+		float angle = radians(aRotationAlpha.x);
+		vec2 local = (aPos - 0.5) * aRect.zw;
+		vec2 rotated = vec2(local.x * cos(angle) - local.y * sin(angle), local.x * sin(angle) + local.y * cos(angle));
+
+		gl_Position = projection * vec4(aRect.xy + 0.5 * aRect.zw + rotated, 0.0, 1.0);
+		TexCoords = mix(aTexRect.xy, aTexRect.zw, aPos);
+		Alpha = aRotationAlpha.y;
+		BlendColor = aBlendColor;
+	}
+)";
+
+const char* imageFragmentShaderSource = R"(
+	#version 330 core
+
+    in vec2 TexCoords;
+    in float Alpha;
+    in vec3 BlendColor;
+    out vec4 color;
+
+    uniform sampler2D image;
+
+    void main() {
+        vec4 texColor = texture(image, TexCoords);
+        float threshold = 1;
+        // Check if the pixel is close to white
+        if (length(texColor.rgb - vec3(1.0, 1.0, 1.0)) < threshold) {
+            color = vec4(BlendColor, texColor.a * Alpha);
+        } else {
+            color = vec4(texColor.rgb, texColor.a * Alpha);
+        }
+    }
+)";
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+    GLuint vertex, fragment;
+
+    vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex, 1, &vertexPath, NULL);
+    glCompileShader(vertex);
+    checkCompileErrors(vertex, "VERTEX");
+
+    fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment, 1, &fragmentPath, NULL);
+    glCompileShader(fragment);
+    checkCompileErrors(fragment, "FRAGMENT");
+
+    this->Program = glCreateProgram();
+    glAttachShader(this->Program, vertex);
+    glAttachShader(this->Program, fragment);
+    glLinkProgram(this->Program);
+    checkCompileErrors(this->Program, "PROGRAM");
+
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    // Every shader reads the projection from the shared block
+    GLuint matricesIndex = glGetUniformBlockIndex(this->Program, "Matrices");
+    if (matricesIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(this->Program, matricesIndex, MATRICES_BINDING);
+    }
+}
+
+void Shader::Use() {
+    glUseProgram(this->Program);
+}
+
+void Shader::checkCompileErrors(GLuint shader, std::string type) {
+    GLint success;
+    GLchar infoLog[1024];
+    if (type != "PROGRAM") {
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << std::endl;
+        }
+    }
+    else {
+        glGetProgramiv(shader, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << std::endl;
+        }
+    }
+}
+
+RenderState::RenderState() {
+    invalidate();
+}
+
+// Records the new value, returns false if it was already bound
+bool RenderState::change(GLuint& cached, GLuint value) {
+    if (cached == value) {
+        counters.avoided++;
+        return false;
+    }
+    cached = value;
+    counters.issued++;
+    return true;
+}
+
+void RenderState::useProgram(GLuint program) {
+    if (change(this->program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void RenderState::bindVertexArray(GLuint vertexArray) {
+    if (change(this->vertexArray, vertexArray)) {
+        glBindVertexArray(vertexArray);
+    }
+}
+
+void RenderState::bindBuffer(GLenum target, GLuint buffer) {
+    GLuint* cached = nullptr;
+    if (target == GL_ARRAY_BUFFER) {
+        cached = &arrayBuffer;
+    }
+    else if (target == GL_UNIFORM_BUFFER) {
+        cached = &uniformBuffer;
+    }
+
+    // Other targets are not tracked, the element buffer for example is part of the vertex array
+    if (!cached) {
+        counters.issued++;
+        glBindBuffer(target, buffer);
+    }
+    else if (change(*cached, buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void RenderState::bindTexture(GLuint unit, GLuint texture) {
+    if (unit >= TEXTURE_UNITS) {
+        counters.issued++;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        activeUnit = unit;
+        return;
+    }
+
+    if (textures[unit] == texture) {
+        counters.avoided++;
+        return;
+    }
+    if (change(activeUnit, unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    change(textures[unit], texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void RenderState::invalidate() {
+    program = UNKNOWN;
+    vertexArray = UNKNOWN;
+    arrayBuffer = UNKNOWN;
+    uniformBuffer = UNKNOWN;
+    activeUnit = UNKNOWN;
+    std::fill(textures, textures + TEXTURE_UNITS, UNKNOWN);
+}
+
+void RenderState::resetCounters() {
+    counters = RenderStateCounters();
+}
+
+const RenderStateCounters& RenderState::getCounters() const {
+    return counters;
+}
+
+StreamBuffer::StreamBuffer(RenderState& state, size_t sliceSize) : state(state), sliceSize(sliceSize), currentSlice(0), sliceUsed(0) {
+    std::fill(fences, fences + FRAME_SLICES, (GLsync)0);
+
+    glGenBuffers(1, &buffer);
+    state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, sliceSize * FRAME_SLICES, NULL, GL_STREAM_DRAW);
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (int i = 0; i < FRAME_SLICES; ++i) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+        }
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+GLuint StreamBuffer::getBuffer() const {
+    return buffer;
+}
+
+size_t StreamBuffer::append(const void* data, size_t size, size_t alignment) {
+    size_t sliceStart = currentSlice * sliceSize;
+    size_t offset = (sliceStart + sliceUsed + alignment - 1) / alignment * alignment;
+    if (offset + size > sliceStart + sliceSize) {
+        grow(size + alignment);
+        sliceStart = currentSlice * sliceSize;
+        offset = (sliceStart + alignment - 1) / alignment * alignment;
+    }
+
+    if (size > 0) {
+        // The fences guarantee the GPU is done with this part of the slice, so no implicit sync is needed
+        state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+        void* target = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (target) {
+            memcpy(target, data, size);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        else {
+            std::cerr << "ERROR::STREAM_BUFFER: Failed to map the stream buffer" << std::endl;
+        }
+    }
+
+    sliceUsed = offset + size - sliceStart;
+    return offset;
+}
+
+void StreamBuffer::nextFrame() {
+    if (fences[currentSlice]) {
+        glDeleteSync(fences[currentSlice]);
+    }
+    fences[currentSlice] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    currentSlice = (currentSlice + 1) % FRAME_SLICES;
+    sliceUsed = 0;
+
+    if (fences[currentSlice]) {
+        const GLuint64 oneSecond = 1000000000;
+        GLenum result;
+        do {
+            result = glClientWaitSync(fences[currentSlice], GL_SYNC_FLUSH_COMMANDS_BIT, oneSecond);
+        } while (result == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(fences[currentSlice]);
+        fences[currentSlice] = 0;
+    }
+}
+
+// Reallocates with bigger slices. The old storage is orphaned, draws already issued keep
+// reading it, so none of the new slices is in use by the GPU.
+void StreamBuffer::grow(size_t minimumSize) {
+    size_t newSliceSize = sliceSize * 2;
+    while (newSliceSize < minimumSize) {
+        newSliceSize *= 2;
+    }
+    sliceSize = newSliceSize;
+
+    state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, sliceSize * FRAME_SLICES, NULL, GL_STREAM_DRAW);
+
+    for (int i = 0; i < FRAME_SLICES; ++i) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+    }
+    sliceUsed = 0;
+}
+
+const GLBackend::StreamAttribute GLBackend::vertexAttributes[2] = {
+    { 0, 2, offsetof(ColorVertex, x) },
+    { 1, 4, offsetof(ColorVertex, r) }
+};
+
+const GLBackend::StreamAttribute GLBackend::textAttributes[2] = {
+    { 0, 4, offsetof(TextVertex, x) },
+    { 1, 4, offsetof(TextVertex, r) }
+};
+
+const GLBackend::StreamAttribute GLBackend::spriteAttributes[4] = {
+    { 1, 4, offsetof(SpriteInstance, x) },
+    { 2, 4, offsetof(SpriteInstance, u0) },
+    { 3, 2, offsetof(SpriteInstance, rotation) },
+    { 4, 3, offsetof(SpriteInstance, r) }
+};
+
+const GLBackend::StreamAttribute GLBackend::circleAttributes[2] = {
+    { 1, 3, offsetof(CircleInstance, cx) },
+    { 2, 4, offsetof(CircleInstance, red) }
+};
+
+const GLBackend::StreamAttribute GLBackend::timerAttributes[1] = {
+    { 1, 4, offsetof(TimerInstance, cx) }
+};
+
+GLBackend::GLBackend() {
+    shader = new Shader(vertexShaderSource, fragmentShaderSource);
+    textShader = new Shader(textVertexShaderSource, textFragmentShaderSource);
+    sdfTextShader = new Shader(textVertexShaderSource, sdfTextFragmentShaderSource);
+	imageShader = new Shader(imageVertexShaderSource, imageFragmentShaderSource);
+	circleShader = new Shader(circleVertexShaderSource, fragmentShaderSource);
+	timerShader = new Shader(timerVertexShaderSource, timerFragmentShaderSource);
+
+    stream = new StreamBuffer(state, STREAM_SLICE_SIZE);
+    offscreenFBO = 0;
+    offscreenTexture = 0;
+    offscreenSize = glm::ivec2(0);
+
+    // Shared projection block, only rewritten when the projection changes
+    glGenBuffers(1, &matricesUBO);
+    state.bindBuffer(GL_UNIFORM_BUFFER, matricesUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MATRICES_BINDING, matricesUBO);
+    state.bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Glyph rows and small mip levels are not 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    initRectangleData();
+    initTextData();
+    initSpriteData();
+    initCircleData();
+    initTimerData();
+
+    // The init functions bind vertex arrays directly
+    state.invalidate();
+}
+
+GLBackend::~GLBackend() {
+    delete stream;
+    delete shader;
+    delete textShader;
+    delete sdfTextShader;
+    delete imageShader;
+    delete circleShader;
+    delete timerShader;
+
+    if (!buffers.empty()) {
+        glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+    }
+    glDeleteBuffers(1, &matricesUBO);
+    glDeleteBuffers(1, &imageVBO);
+    glDeleteBuffers(1, &imageEBO);
+    glDeleteBuffers(1, &circleVBO);
+    GLuint vertexArrays[5] = { VAO, textVAO, imageVAO, circleVAO, timerVAO };
+    glDeleteVertexArrays(5, vertexArrays);
+
+    if (offscreenFBO != 0) {
+        glDeleteFramebuffers(1, &offscreenFBO);
+        glDeleteTextures(1, &offscreenTexture);
+    }
+}
+
+const RenderStateCounters& GLBackend::getStateCounters() const {
+    return state.getCounters();
+}
+
+// Starts a frame: resets the state counters and resyncs the cache with GL
+void GLBackend::beginFrame() {
+    state.resetCounters();
+    state.invalidate();
+    stream->nextFrame();
+}
+
+void GLBackend::setViewport(int width, int height) {
+    glViewport(0, 0, width, height);
+}
+
+void GLBackend::setClearColor(const glm::vec4& color) {
+    glClearColor(color.r, color.g, color.b, color.a);
+}
+
+void GLBackend::setProjectionMatrix(const glm::mat4& projection) {
+    state.bindBuffer(GL_UNIFORM_BUFFER, matricesUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
+}
+
+GLuint GLBackend::getStreamBuffer() const {
+    return stream->getBuffer();
+}
+
+size_t GLBackend::appendStream(const void* data, size_t size, size_t alignment) {
+    return stream->append(data, size, alignment);
+}
+
+GLuint GLBackend::createBuffer(size_t size) {
+    std::vector<unsigned char> empty(size, 0);
+
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, size, empty.data(), GL_DYNAMIC_DRAW);
+
+    buffers.push_back(buffer);
+    return buffer;
+}
+
+void GLBackend::updateBuffer(GLuint buffer, size_t offset, const void* data, size_t size) {
+    state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+}
+
+void GLBackend::deleteBuffer(GLuint buffer) {
+    // Deleting unbinds it, forget the cache so a new buffer reusing the name gets bound again
+    state.invalidate();
+    glDeleteBuffers(1, &buffer);
+    buffers.erase(std::remove(buffers.begin(), buffers.end(), buffer), buffers.end());
+}
+
+GLuint GLBackend::createTexture() {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    return texture;
+}
+
+void GLBackend::uploadTexture(GLuint texture, const TextureDesc& desc, const unsigned char* const* levels) {
+    GLenum format = desc.format == TextureFormat::Red ? GL_RED : GL_RGBA;
+    GLenum internalFormat = desc.format == TextureFormat::Red ? GL_R8 : GL_RGBA8;
+
+    state.bindTexture(0, texture);
+    for (int level = 0; level < desc.levelCount; ++level) {
+        int levelWidth = std::max(1, desc.width >> level);
+        int levelHeight = std::max(1, desc.height >> level);
+        glTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelWidth, levelHeight, 0, format, GL_UNSIGNED_BYTE, levels ? levels[level] : NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, desc.maxLevel);
+    if (desc.maxLevel >= desc.levelCount) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    GLint magFilter = desc.nearest ? GL_NEAREST : GL_LINEAR;
+    GLint minFilter = desc.maxLevel > 0 ? GL_LINEAR_MIPMAP_LINEAR : magFilter;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+}
+
+void GLBackend::deleteTexture(GLuint texture) {
+    // Deleting unbinds it, forget the cache so a new texture reusing the name gets bound again
+    state.invalidate();
+    glDeleteTextures(1, &texture);
+}
+
+void GLBackend::draw(const DrawCall& call) {
+    switch (call.primitive) {
+    case RenderPrimitive::Rectangle:
+        state.useProgram(shader->Program);
+        state.bindVertexArray(VAO);
+        setAttributes(call.buffer, vertexAttributes, 2, sizeof(ColorVertex), call.offset);
+        glDrawArrays(GL_TRIANGLES, 0, call.count);
+        break;
+
+    case RenderPrimitive::Circle:
+        state.useProgram(circleShader->Program);
+        state.bindVertexArray(circleVAO);
+        setAttributes(call.buffer, circleAttributes, 2, sizeof(CircleInstance), call.offset);
+        glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, CIRCLE_SEGMENTS + 2, call.count);
+        break;
+
+    case RenderPrimitive::Timer:
+        state.useProgram(timerShader->Program);
+        state.bindVertexArray(timerVAO);
+        setAttributes(call.buffer, timerAttributes, 1, sizeof(TimerInstance), call.offset);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, call.count);
+        break;
+
+    case RenderPrimitive::Sprite:
+        state.useProgram(imageShader->Program);
+        state.bindVertexArray(imageVAO);
+        setAttributes(call.buffer, spriteAttributes, 4, sizeof(SpriteInstance), call.offset);
+        state.bindTexture(0, call.texture);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, call.count);
+        break;
+
+    case RenderPrimitive::Text:
+        state.useProgram(call.distanceField ? sdfTextShader->Program : textShader->Program);
+        state.bindTexture(0, call.texture);
+        state.bindVertexArray(textVAO);
+        setAttributes(call.buffer, textAttributes, 2, sizeof(TextVertex), call.offset);
+        glDrawArrays(GL_TRIANGLES, 0, call.count);
+        break;
+    }
+}
+
+void GLBackend::beginOffscreen(int width, int height) {
+    if (offscreenFBO == 0) {
+        glGenFramebuffers(1, &offscreenFBO);
+        glGenTextures(1, &offscreenTexture);
+    }
+
+    // (Re)allocate the color target when the window size changed
+    if (offscreenSize != glm::ivec2(width, height)) {
+        offscreenSize = glm::ivec2(width, height);
+
+        state.bindTexture(0, offscreenTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, offscreenFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, offscreenTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "ERROR::FRAMEBUFFER: Offscreen framebuffer is not complete" << std::endl;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, offscreenFBO);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void GLBackend::endOffscreen() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GLBackend::drawOffscreen() {
+    if (offscreenFBO == 0) {
+        return;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, offscreenFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, offscreenSize.x, offscreenSize.y, 0, 0, offscreenSize.x, offscreenSize.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Points the attributes of the bound vertex array at records starting at the given byte offset of the buffer
+void GLBackend::setAttributes(GLuint buffer, const StreamAttribute* attributes, int count, GLsizei stride, size_t offset) {
+    state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (int i = 0; i < count; ++i) {
+        glVertexAttribPointer(attributes[i].index, attributes[i].size, GL_FLOAT, GL_FALSE, stride, (void*)(offset + attributes[i].offset));
+    }
+}
+
+void GLBackend::initRectangleData() {
+    // Rectangle vertices come from the stream buffer or a retained buffer, the draw points the attributes at them
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    setAttributes(stream->getBuffer(), vertexAttributes, 2, sizeof(ColorVertex), 0);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+}
+
+void GLBackend::initTextData() {
+    // Text vertices come from the stream buffer or a retained buffer, the draw points the attributes at them
+    glGenVertexArrays(1, &textVAO);
+    glBindVertexArray(textVAO);
+    setAttributes(stream->getBuffer(), textAttributes, 2, sizeof(TextVertex), 0);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+}
+
+void GLBackend::initSpriteData() {
+    // Unit quad shared by every sprite, the instance buffer positions and scales it
+    float vertices[] = {
+        // Positions
+        0.0f, 0.0f,
+        1.0f, 0.0f,
+        1.0f, 1.0f,
+        0.0f, 1.0f
+    };
+
+    unsigned int indices[] = {
+        0, 1, 2,
+        2, 3, 0
+    };
+
+    // Generate and bind the VAO, VBO, and EBO
+    glGenVertexArrays(1, &imageVAO);
+    glGenBuffers(1, &imageVBO);
+    glGenBuffers(1, &imageEBO);
+
+    glBindVertexArray(imageVAO);
+
+    state.bindBuffer(GL_ARRAY_BUFFER, imageVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, imageEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    // Set the vertex attribute pointers
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Per-instance attributes from the stream buffer
+    setAttributes(stream->getBuffer(), spriteAttributes, 4, sizeof(SpriteInstance), 0);
+    for (GLuint attribute = 1; attribute <= 4; ++attribute) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+
+    state.bindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void GLBackend::initCircleData() {
+    // Center followed by the rim, starting at the top like the old per-call fan
+    std::vector<glm::vec2> unitCircle;
+    unitCircle.push_back(glm::vec2(0.0f, 0.0f));
+    float angleStep = 2.0f * M_PI / CIRCLE_SEGMENTS;
+    for (int i = 0; i <= CIRCLE_SEGMENTS; ++i) {
+        float angle = M_PI / 2.0f + i * angleStep;
+        unitCircle.push_back(glm::vec2(cos(angle), sin(angle)));
+    }
+
+    glGenVertexArrays(1, &circleVAO);
+    glGenBuffers(1, &circleVBO);
+
+    glBindVertexArray(circleVAO);
+
+    state.bindBuffer(GL_ARRAY_BUFFER, circleVBO);
+    glBufferData(GL_ARRAY_BUFFER, unitCircle.size() * sizeof(glm::vec2), unitCircle.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Per-instance center, radius and color from the stream buffer
+    setAttributes(stream->getBuffer(), circleAttributes, 2, sizeof(CircleInstance), 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+
+    state.bindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void GLBackend::initTimerData() {
+    // Reuses the unit quad of the sprites
+    glGenVertexArrays(1, &timerVAO);
+
+    glBindVertexArray(timerVAO);
+
+    state.bindBuffer(GL_ARRAY_BUFFER, imageVBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, imageEBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Per-instance center, radius and progress from the stream buffer
+    setAttributes(stream->getBuffer(), timerAttributes, 1, sizeof(TimerInstance), 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+
+    state.bindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,168 @@
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "RenderBackend.h"
+
+#ifndef GL_BACKEND_H
+#define GL_BACKEND_H
+
+// Binding point of the uniform block holding the projection matrix
+const GLuint MATRICES_BINDING = 0;
+
+class Shader {
+public:
+    GLuint Program;
+
+    Shader(const char* vertexPath, const char* fragmentPath);
+    void Use();
+
+private:
+    void checkCompileErrors(GLuint shader, std::string type);
+};
+
+// Number of state changes the RenderState sent to GL and skipped as redundant
+struct RenderStateCounters {
+    unsigned int issued = 0;
+    unsigned int avoided = 0;
+};
+
+// Cache of the bound GL objects, binds that would not change anything are skipped
+class RenderState {
+public:
+    static const int TEXTURE_UNITS = 8;
+
+    RenderState();
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindTexture(GLuint unit, GLuint texture);
+
+    // Forgets the cached bindings, needed after GL calls that bypass the cache
+    void invalidate();
+    void resetCounters();
+    const RenderStateCounters& getCounters() const;
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint arrayBuffer;
+    GLuint uniformBuffer;
+    GLuint activeUnit;
+    GLuint textures[TEXTURE_UNITS];
+    RenderStateCounters counters;
+
+    bool change(GLuint& cached, GLuint value);
+};
+
+// Ring buffer for per-frame geometry, split into one slice per frame in flight.
+// Data is appended with unsynchronized mapping, a fence per slice keeps the CPU from
+// overwriting a slice the GPU is still reading.
+class StreamBuffer {
+public:
+    static const int FRAME_SLICES = 3;
+
+    StreamBuffer(RenderState& state, size_t sliceSize);
+    ~StreamBuffer();
+    GLuint getBuffer() const;
+
+    // Copies the data into the current slice and returns its byte offset in the buffer
+    size_t append(const void* data, size_t size, size_t alignment);
+    // Fences the finished slice and moves on to the next one, waiting if the GPU still uses it
+    void nextFrame();
+
+private:
+    RenderState& state;
+    GLuint buffer;
+    size_t sliceSize;
+    int currentSlice;
+    size_t sliceUsed;
+    GLsync fences[FRAME_SLICES];
+
+    void grow(size_t minimumSize);
+};
+
+// OpenGL 3.3 implementation: shaders per primitive, instanced unit shapes and a fenced stream buffer
+class GLBackend : public RenderBackend {
+public:
+    GLBackend();
+    ~GLBackend();
+
+    // Counters of the current frame, reset by beginFrame
+    const RenderStateCounters& getStateCounters() const;
+
+    void beginFrame() override;
+    void setViewport(int width, int height) override;
+    void setClearColor(const glm::vec4& color) override;
+    void setProjectionMatrix(const glm::mat4& projection) override;
+
+    GLuint getStreamBuffer() const override;
+    size_t appendStream(const void* data, size_t size, size_t alignment) override;
+
+    GLuint createBuffer(size_t size) override;
+    void updateBuffer(GLuint buffer, size_t offset, const void* data, size_t size) override;
+    void deleteBuffer(GLuint buffer) override;
+
+    GLuint createTexture() override;
+    void uploadTexture(GLuint texture, const TextureDesc& desc, const unsigned char* const* levels) override;
+    void deleteTexture(GLuint texture) override;
+
+    void draw(const DrawCall& call) override;
+
+    void beginOffscreen(int width, int height) override;
+    void endOffscreen() override;
+    void drawOffscreen() override;
+
+private:
+    RenderState state;
+
+    Shader* shader;
+    Shader* textShader;
+    Shader* sdfTextShader;
+    Shader* imageShader;
+    Shader* circleShader;
+    Shader* timerShader;
+    GLuint matricesUBO;
+
+    GLuint VAO;
+    GLuint textVAO;
+    GLuint imageVAO, imageVBO, imageEBO;
+    GLuint circleVAO, circleVBO;
+    GLuint timerVAO;
+
+    // All transient geometry is appended here, draws reference it by offset
+    static const size_t STREAM_SLICE_SIZE = 1024 * 1024;
+    StreamBuffer* stream;
+
+    std::vector<GLuint> buffers;
+
+    // Offscreen color target
+    GLuint offscreenFBO, offscreenTexture;
+    glm::ivec2 offscreenSize;
+
+    // Float attribute read from a record buffer, offset is relative to the start of a record
+    struct StreamAttribute {
+        GLuint index;
+        GLint size;
+        size_t offset;
+    };
+
+    static const StreamAttribute vertexAttributes[2];
+    static const StreamAttribute textAttributes[2];
+    static const StreamAttribute spriteAttributes[4];
+    static const StreamAttribute circleAttributes[2];
+    static const StreamAttribute timerAttributes[1];
+
+    void setAttributes(GLuint buffer, const StreamAttribute* attributes, int count, GLsizei stride, size_t offset);
+    void initRectangleData();
+    void initTextData();
+    void initSpriteData();
+    void initCircleData();
+    void initTimerData();
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "LotLayout.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Outer radius of the indicator, clicks inside it hit the blink light
+static const float INDICATOR_RADIUS = 37.0f;
+// The car is inset by this much on every side of its bay
+static const float CAR_INSET = 20.0f;
+
+static std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// False unless the whole value is a number of at least the minimum
+static bool parseNumber(const std::string& value, float minimum, float& result) {
+    char* end = nullptr;
+    float parsed = std::strtof(value.c_str(), &end);
+    if (end == value.c_str() || *end != '\0' || !(parsed >= minimum)) {
+        return false;
+    }
+    result = parsed;
+    return true;
+}
+
+LotLayout::LotLayout() : columns(3), compactHeight(745.0f), originX(0.0f), originY(0.0f) {
+    resetSpacing();
+    rows.push_back({ "A", false });
+    rows.push_back({ "B", true });
+    updateNames();
+}
+
+void LotLayout::resetSpacing() {
+    cellWidth = 1400 / 5.5f;
+    cellHeight = cellWidth * 1.4f;
+    spotSpacing = 60.0f;
+    columnSpacing = 100.0f;
+}
+
+// The car needs room in its bay, and the indicator has to stay within the neighbouring cells for the hit tests
+bool LotLayout::isSpacingValid() const {
+    bool carFits = cellWidth - spotSpacing > 2 * CAR_INSET && cellHeight - spotSpacing > 2 * CAR_INSET;
+    bool indicatorFits = spotSpacing - 10.0f + INDICATOR_RADIUS <= cellWidth + columnSpacing && 1.5f * cellHeight >= 35.0f + INDICATOR_RADIUS;
+    return carFits && indicatorFits;
+}
+
+bool LotLayout::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::vector<Row> loadedRows;
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        std::string key = equals == std::string::npos ? line : trim(line.substr(0, equals));
+        std::string value = equals == std::string::npos ? "" : trim(line.substr(equals + 1));
+
+        bool valid = true;
+        if (key == "columns") {
+            float count;
+            valid = parseNumber(value, 1.0f, count) && count == std::floor(count);
+            if (valid) {
+                columns = static_cast<int>(count);
+            }
+        }
+        else if (key == "cell_width") {
+            valid = parseNumber(value, 1.0f, cellWidth);
+        }
+        else if (key == "cell_height") {
+            valid = parseNumber(value, 1.0f, cellHeight);
+        }
+        else if (key == "spot_spacing") {
+            valid = parseNumber(value, 0.0f, spotSpacing);
+        }
+        else if (key == "column_spacing") {
+            valid = parseNumber(value, 0.0f, columnSpacing);
+        }
+        else if (key == "compact_height") {
+            valid = parseNumber(value, 0.0f, compactHeight);
+        }
+        else if (key == "row") {
+            std::istringstream words(value);
+            Row row = { "", false };
+            words >> row.name;
+            valid = !row.name.empty();
+            std::string option;
+            while (words >> option) {
+                valid = valid && option == "flipped";
+                row.flipped = true;
+            }
+            if (valid) {
+                loadedRows.push_back(row);
+            }
+        }
+        else {
+            valid = false;
+        }
+
+        if (!valid) {
+            std::cerr << "ERROR::LOT_LAYOUT: " << path << ":" << lineNumber << ": Ignoring \"" << line << "\"" << std::endl;
+        }
+    }
+
+    if (!isSpacingValid()) {
+        std::cerr << "ERROR::LOT_LAYOUT: " << path << ": spot_spacing " << spotSpacing << " leaves no room for the bays in "
+            << cellWidth << "x" << cellHeight << " cells, using the default sizes" << std::endl;
+        resetSpacing();
+    }
+    if (!loadedRows.empty()) {
+        rows = loadedRows;
+    }
+    spots.clear();
+    updateNames();
+    return true;
+}
+
+void LotLayout::updateNames() {
+    names.clear();
+    for (const Row& row : rows) {
+        for (int column = 0; column < columns; ++column) {
+            names.push_back(row.name + std::to_string(column + 1));
+        }
+    }
+}
+
+void LotLayout::update(int windowWidth, int windowHeight) {
+    // The whole lot is centered, without the spacing after the last column
+    float totalWidth = columns * (cellWidth + columnSpacing) - columnSpacing;
+    float totalHeight = getRowCount() * cellHeight;
+    originX = (windowWidth - totalWidth) / 2.0f + spotSpacing / 2;
+    originY = (windowHeight - totalHeight) / 2.0f;
+    if (windowHeight < compactHeight) {
+        originY -= std::floor((compactHeight - windowHeight) / 2);
+    }
+
+    spots.resize(getSpotCount());
+    for (int row = 0; row < getRowCount(); ++row) {
+        for (int column = 0; column < columns; ++column) {
+            SpotGeometry& spot = spots[getSpotIndex(row, column)];
+            spot.x = originX + column * (cellWidth + columnSpacing);
+            spot.y = originY + (getRowCount() - 1 - row) * cellHeight;
+            spot.width = cellWidth - spotSpacing;
+            spot.height = cellHeight - spotSpacing;
+
+            spot.carX = spot.x + CAR_INSET;
+            spot.carY = spot.y + CAR_INSET;
+            spot.carWidth = spot.width - 2 * CAR_INSET;
+            spot.carHeight = spot.height - 2 * CAR_INSET;
+            spot.rotation = rows[row].flipped ? 180.0f : 0.0f;
+
+            spot.indicatorX = spot.x - spotSpacing + 10.0f;
+            spot.indicatorY = spot.y + cellHeight / 2 - 35.0f;
+            spot.labelX = spot.x + spot.width;
+            spot.labelY = spot.y - 23.0f;
+        }
+    }
+}
+
+int LotLayout::findRow(char letter) const {
+    for (int row = 0; row < getRowCount(); ++row) {
+        if (std::toupper(static_cast<unsigned char>(rows[row].name[0])) == std::toupper(static_cast<unsigned char>(letter))) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+// Parts reach at most into the neighbouring cells, the indicator sits in the gap left of its bay
+template<typename Test>
+int LotLayout::findSpot(float x, float y, Test test) const {
+    if (spots.empty()) {
+        return -1;
+    }
+
+    int column = static_cast<int>(std::floor((x - originX) / (cellWidth + columnSpacing)));
+    int row = getRowCount() - 1 - static_cast<int>(std::floor((y - originY) / cellHeight));
+    for (int r = std::max(row - 1, 0); r <= std::min(row + 1, getRowCount() - 1); ++r) {
+        for (int c = std::max(column - 1, 0); c <= std::min(column + 1, columns - 1); ++c) {
+            int index = getSpotIndex(r, c);
+            if (test(spots[index])) {
+                return index;
+            }
+        }
+    }
+    return -1;
+}
+
+int LotLayout::findIndicator(float x, float y) const {
+    return findSpot(x, y, [x, y](const SpotGeometry& spot) {
+        float dx = x - spot.indicatorX;
+        float dy = y - spot.indicatorY;
+        return dx * dx + dy * dy <= INDICATOR_RADIUS * INDICATOR_RADIUS;
+    });
+}
+
+int LotLayout::findCar(float x, float y) const {
+    return findSpot(x, y, [x, y](const SpotGeometry& spot) {
+        return x >= spot.carX && x <= spot.carX + spot.carWidth && y >= spot.carY && y <= spot.carY + spot.carHeight;
+    });
+}
@@ -0,0 +1,82 @@
+#include <string>
+#include <vector>
+
+#ifndef LOT_LAYOUT_H
+#define LOT_LAYOUT_H
+
+// Where the parts of one spot go, in window pixels from the bottom left corner
+struct SpotGeometry {
+    // Parking bay, the car is inset into it
+    float x, y, width, height;
+    float carX, carY, carWidth, carHeight;
+    // Degrees, 180 in flipped rows
+    float rotation;
+    // Center of the timer ring and the blink light
+    float indicatorX, indicatorY;
+    // The spot label is right aligned to this point
+    float labelX, labelY;
+};
+
+// Lot geometry: rows of equal bays centered in the window, read from a config file of "key = value" lines.
+// Lines starting with # are comments, the keys and their defaults:
+//   columns = 3                bays per row, digit keys 1 to 9 select the first nine
+//   cell_width = 254.545456    pixels per column, the column spacing comes on top
+//   cell_height = 356.363647   pixels per row
+//   spot_spacing = 60          taken off the cell for the bay, the indicator sits in it
+//   column_spacing = 100       extra gap between the columns
+//   compact_height = 745       a lower window moves the lot down by half the difference
+//   row = A                    one line per row from the top, the name labels its spots
+//   row = B flipped            cars in flipped rows face down
+// The spot table is computed by update() for the window size and read until the next resize.
+class LotLayout {
+public:
+    // The original lot of two rows of three
+    LotLayout();
+
+    // Keeps the defaults for anything missing or invalid in the file, false if there is no file.
+    // Cell sizes and spacings that leave no room for the cars or the indicators all go back to the defaults.
+    // The spot table is empty until the next update().
+    bool load(const std::string& path);
+    void update(int windowWidth, int windowHeight);
+
+    int getRowCount() const { return static_cast<int>(rows.size()); }
+    int getColumnCount() const { return columns; }
+    int getSpotCount() const { return getRowCount() * columns; }
+    int getSpotIndex(int row, int column) const { return row * columns + column; }
+
+    const SpotGeometry& getSpot(int index) const { return spots[index]; }
+    // Row name and column number, like "A1"
+    const std::string& getSpotName(int index) const { return names[index]; }
+    // Row whose name starts with the letter, ignoring case, -1 if none
+    int findRow(char letter) const;
+
+    // Spot whose indicator or car contains the point, -1 if none
+    int findIndicator(float x, float y) const;
+    int findCar(float x, float y) const;
+
+private:
+    struct Row {
+        std::string name;
+        bool flipped;
+    };
+
+    int columns;
+    float cellWidth, cellHeight;
+    float spotSpacing, columnSpacing;
+    float compactHeight;
+    std::vector<Row> rows;
+
+    std::vector<std::string> names;
+    std::vector<SpotGeometry> spots;
+    // Bay of the first column in the bottom row, the hit tests start from its grid cell
+    float originX, originY;
+
+    void resetSpacing();
+    bool isSpacingValid() const;
+    void updateNames();
+    // Spot at the grid cell of the point or next to it that passes the test
+    template<typename Test>
+    int findSpot(float x, float y, Test test) const;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#include <cstddef>
+#include <string>
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+// Read-only memory mapping of a whole file, unmapped when the object goes away
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const std::string& path);
+    void close();
+
+    const unsigned char* getData() const { return data; }
+    size_t getSize() const { return size; }
+    bool isOpen() const { return data != nullptr; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    void* file;
+    void* mapping;
+#endif
+};
+
+#endif
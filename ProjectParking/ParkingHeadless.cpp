@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "AssetPack.h"
+#include "FrameStats.h"
+#include "LotLayout.h"
+#include "ParkingScene.h"
+#include "Profiler.h"
+#include "RecordingBackend.h"
+#include "SoftwareBackend.h"
+#include "SpotKernels.h"
+#include "SpotStore.h"
+#include "TaskPool.h"
+
+// Runs the parking scene without a window, GL context or sound, for benchmarks and tests:
+//   ParkingHeadless [--profile [trace.json]] [frames]
+//       records the commands, then prints those of the last frame and the per-frame averages
+//   ParkingHeadless [--profile [trace.json]] --software [frames] [image.ppm]
+//       also rasterizes the frames on the CPU and saves the last one
+//   ParkingHeadless --sweep [spots]
+//       times the timer ring sweep of a lot that size with every kernel the CPU supports
+// Every spot of the lot in lot.cfg is occupied, and the frames step the clock by exactly 1/60 s.
+// --spot-kernel scalar|SSE2|AVX2 picks the sweep kernel, capped at the best one the CPU supports.
+// --threads <count> sizes the task pool, one per hardware thread by default.
+
+const int WIDTH = 1400;
+const int HEIGHT = 800;
+const float FRAME_STEP = 1.0f / 60.0f;
+const int SWEEP_RUNS = 100;
+// Ring steps, as in the scene
+const int SWEEP_STEPS = 512;
+
+// Matches the names getSpotKernelName() prints, ignoring case
+static bool parseKernelLevel(const std::string& name, SpotKernelLevel& level) {
+    for (SpotKernelLevel candidate : { SpotKernelLevel::Scalar, SpotKernelLevel::SSE2, SpotKernelLevel::AVX2 }) {
+        std::string candidateName = getSpotKernelName(candidate);
+        bool same = candidateName.size() == name.size();
+        for (size_t i = 0; same && i < name.size(); ++i) {
+            same = tolower(static_cast<unsigned char>(name[i])) == tolower(static_cast<unsigned char>(candidateName[i]));
+        }
+        if (same) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Every spot occupied at a random point of its time and drawn a frame ago, so the sweep sees the
+// steps a real frame sees. Prints the average time per sweep on this thread and split over the pool.
+static void benchmarkSweep(size_t spotCount, TaskPool& pool, SpotKernelLevel highestLevel) {
+    SpotStore store(spotCount);
+    const float color[3] = { 1.0f, 1.0f, 1.0f };
+    float now = PARKING_DURATION;
+    for (size_t spot = 0; spot < spotCount; ++spot) {
+        store.occupy(spot, now * static_cast<float>(rand()) / RAND_MAX, PARKING_DURATION, "", "", color);
+        store.drawnSteps[spot] = store.getRingStep(spot, now - FRAME_STEP, SWEEP_STEPS);
+    }
+
+    std::cout << "Ring sweep of " << spotCount << " spots, " << pool.getWorkerCount() + 1 << " threads with the pool" << std::endl;
+    std::vector<uint64_t> mask;
+    for (int level = 0; level <= static_cast<int>(highestLevel); ++level) {
+        store.setKernelLevel(static_cast<SpotKernelLevel>(level));
+        double milliseconds[2];
+        for (int pooled = 0; pooled < 2; ++pooled) {
+            TaskPool* sweepPool = pooled ? &pool : nullptr;
+            store.findRingRedraws(now, SWEEP_STEPS, mask, sweepPool);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int run = 0; run < SWEEP_RUNS; ++run) {
+                store.findRingRedraws(now, SWEEP_STEPS, mask, sweepPool);
+            }
+            milliseconds[pooled] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / SWEEP_RUNS;
+        }
+        std::cout << getSpotKernelName(store.getKernelLevel()) << ": " << milliseconds[0] << " ms, "
+            << milliseconds[1] << " ms with the pool" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string tracePath = Profiler::parseArguments(argc, argv);
+
+    bool software = false;
+    bool sweep = false;
+    SpotKernelLevel kernelLevel = getSpotKernelLevel();
+    int threadCount = 0;
+    std::vector<std::string> values;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--software") {
+            software = true;
+        }
+        else if (argument == "--sweep") {
+            sweep = true;
+        }
+        else if (argument == "--spot-kernel" && i + 1 < argc) {
+            if (!parseKernelLevel(argv[++i], kernelLevel)) {
+                std::cerr << "ERROR::HEADLESS: Unknown spot kernel " << argv[i] << ", expected scalar, SSE2 or AVX2" << std::endl;
+                return -1;
+            }
+        }
+        else if (argument == "--threads" && i + 1 < argc) {
+            threadCount = std::max(1, atoi(argv[++i]));
+        }
+        else {
+            values.push_back(argument);
+        }
+    }
+
+    TaskPool taskPool(threadCount);
+    srand(static_cast<unsigned int>(time(0)));
+    if (sweep) {
+        long long spotCount = values.size() > 0 ? atoll(values[0].c_str()) : 1000000;
+        benchmarkSweep(static_cast<size_t>(std::max(1LL, spotCount)), taskPool, std::min(kernelLevel, getSpotKernelLevel()));
+        return 0;
+    }
+    int frames = values.size() > 0 ? std::max(1, atoi(values[0].c_str())) : 600;
+    std::string imagePath = values.size() > 1 ? values[1] : "frame.ppm";
+
+    AssetPack assetPack;
+    assetPack.open(ASSET_PACK_PATH);
+    LotLayout lotLayout;
+    lotLayout.load(LOT_CONFIG_PATH);
+
+    SoftwareBackend* softwareBackend = software ? new SoftwareBackend(taskPool) : nullptr;
+    RecordingBackend* backend = software ? softwareBackend : new RecordingBackend();
+    ParkingScene* scene = new ParkingScene(*backend, taskPool, &assetPack, lotLayout, WIDTH, HEIGHT);
+    scene->getSpots().setKernelLevel(kernelLevel);
+    while (!scene->getAssetLoader().isIdle()) {
+        scene->getAssetLoader().update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Every spot occupied, so every primitive is drawn
+    for (int index = 0; index < lotLayout.getSpotCount(); ++index) {
+        scene->handleSpotAction(index, SpotAction::Park);
+    }
+
+    backend->clear();
+    FrameStats frameStats;
+    std::chrono::duration<double, std::milli> updateTime(0), renderTime(0);
+    for (int frame = 0; frame < frames; ++frame) {
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        scene->update(frame * FRAME_STEP);
+        auto updateEnd = std::chrono::high_resolution_clock::now();
+        scene->render();
+        if (softwareBackend) {
+            softwareBackend->finish();
+        }
+        auto renderEnd = std::chrono::high_resolution_clock::now();
+
+        updateTime += updateEnd - frameStart;
+        renderTime += renderEnd - updateEnd;
+
+        FrameTimes times;
+        times.update = std::chrono::duration<double, std::milli>(updateEnd - frameStart).count();
+        times.render = std::chrono::duration<double, std::milli>(renderEnd - updateEnd).count();
+        times.frame = std::chrono::duration<double, std::milli>(renderEnd - frameStart).count();
+        frameStats.record(times);
+    }
+
+    backend->print(std::cout);
+    std::cout << "Spot kernel: " << getSpotKernelName(scene->getSpots().getKernelLevel()) << std::endl;
+    const RecordingStats& stats = backend->getStats();
+    if (stats.frames > 0) {
+        std::cout << stats.frames << " frames: "
+            << updateTime.count() / stats.frames << " ms update, "
+            << renderTime.count() / stats.frames << " ms render, "
+            << static_cast<double>(stats.drawCalls) / stats.frames << " draws, "
+            << static_cast<double>(stats.vertices) / stats.frames << " vertices, "
+            << static_cast<double>(stats.bytesUploaded) / stats.frames << " bytes per frame" << std::endl;
+    }
+    frameStats.print(std::cout);
+
+    int result = 0;
+    if (softwareBackend && !softwareBackend->saveFrame(imagePath)) {
+        std::cerr << "ERROR::HEADLESS: Failed to write " << imagePath << std::endl;
+        result = -1;
+    }
+
+    delete scene;
+    delete backend;
+    Profiler::finish(tracePath);
+    return result;
+}
@@ -0,0 +1,425 @@
+#include "ParkingScene.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+// Timer progress changes smaller than this are not visible on the ring
+static const int PROGRESS_STEPS = 512;
+static const float BLINK_INTERVAL = 0.5f;
+static const float TITLE_TRANSITION_DURATION = 3.0f;
+
+static std::string generateLicensePlate() {
+    std::string licensePlate = "";
+    for (int i = 0; i < 2; ++i) {
+        licensePlate += static_cast<char>(rand() % 26 + 'A');
+    }
+    licensePlate += " ";
+    for (int i = 0; i < 3; ++i) {
+        licensePlate += std::to_string(rand() % 10);
+    }
+    licensePlate += "-";
+    for (int i = 0; i < 2; ++i) {
+        licensePlate += static_cast<char>(rand() % 26 + 'A');
+    }
+    return licensePlate;
+}
+
+static std::string generateDriverName() {
+    std::vector<std::string> names = { "John", "Jane", "Alice", "Bob",
+        "Charlie", "David", "Eve", "Frank", "Grace", "Hank", "Jack", "Kate" };
+    std::vector<std::string> surnames = { "Smith", "Johnson", "Williams", "Jones",
+        "Brown", "Davis", "Miller", "Wilson", "Moore", "Taylor", "Anderson", "Thomas",
+        "Jackson", "White", "Martin", "Thompson", "Garcia", "Martinez", "Robinson",
+        "Clark", "Rodriguez", "Lewis", "Lee", "Walker", "Hall", "Allen" };
+    return names[rand() % names.size()] + " " + surnames[rand() % surnames.size()];
+}
+
+// localtime_s is MSVC only, the POSIX version takes its arguments the other way round
+static tm getLocalTime(time_t time) {
+    tm localTime;
+#ifdef _MSC_VER
+    localtime_s(&localTime, &time);
+#else
+    localtime_r(&time, &localTime);
+#endif
+    return localTime;
+}
+
+ParkingScene::ParkingScene(RenderBackend& backend, TaskPool& pool, const AssetPack* pack, const LotLayout& layout, int width, int height)
+    : pool(pool), readySprites(0), width(width), height(height), layout(layout), currentTime(0.0f), lastTime(0.0f), staticLayerDirty(true),
+    displayParking(true), titleTextColor{ 1.0f, 1.0f, 1.0f }, targetTitleTextColor{ 1.0f, 0.0f, 0.0f },
+    titleTextTransitionProgress(0.0f), reverseTransition(false) {
+    // Distance field text keeps the small labels and the title sharp
+    const unsigned char* fontData = nullptr;
+    size_t fontSize = 0;
+    if (pack) {
+        pack->find("Gill_Sans.otf", AssetType::Font, fontData, fontSize);
+    }
+    renderer = new Renderer(backend, width, height, Renderer::FontMode::SignedDistanceField, fontData, fontSize);
+    renderer->setViewport(width, height);
+    renderer->setClearColor(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+
+    spriteAtlas = new TextureAtlas(backend);
+    assetLoader = new AssetLoader(backend, *spriteAtlas, pool, pack);
+    carSprite = assetLoader->loadImage("car.png");
+    parkingSpotSprite = assetLoader->loadImage("parking_spot.png");
+    backgroundSprite = assetLoader->loadImage("background_whole.jpg");
+
+    this->layout.update(width, height);
+    createScene();
+}
+
+ParkingScene::~ParkingScene() {
+    delete assetLoader;
+    delete spriteAtlas;
+    delete renderer;
+}
+
+void ParkingScene::playSound(SceneSound sound) {
+    if (soundCallback) {
+        soundCallback(sound);
+    }
+}
+
+int ParkingScene::countReadySprites() const {
+    int ready = 0;
+    for (int sprite : { carSprite, parkingSpotSprite, backgroundSprite }) {
+        ready += assetLoader->isReady(sprite) ? 1 : 0;
+    }
+    return ready;
+}
+
+void ParkingScene::markSpotDirty(int index) {
+    if (!spotNodes[index].dirty) {
+        spotNodes[index].dirty = true;
+        dirtySpots.push_back(index);
+    }
+}
+
+void ParkingScene::markSceneDirty() {
+    for (size_t index = 0; index < spotNodes.size(); ++index) {
+        markSpotDirty(static_cast<int>(index));
+    }
+}
+
+void ParkingScene::markLayoutDirty() {
+    staticLayerDirty = true;
+    markSceneDirty();
+}
+
+void ParkingScene::resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+    renderer->setViewport(width, height);
+    renderer->setProjectionMatrix(glm::ortho(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), -1.0f, 1.0f));
+
+    // The spot positions depend on the window size
+    layout.update(width, height);
+    markLayoutDirty();
+}
+
+void ParkingScene::handleSpotAction(int index, SpotAction action) {
+    bool occupied = spots.has(index, SpotStore::OCCUPIED);
+
+    if (!occupied && action != SpotAction::Release) {
+        float carColor[3] = {
+            static_cast<float>(rand()) / RAND_MAX,
+            static_cast<float>(rand()) / RAND_MAX,
+            static_cast<float>(rand()) / RAND_MAX
+        };
+        parkCar(index, generateLicensePlate(), generateDriverName(), carColor);
+    }
+    else if (occupied && action == SpotAction::Renew) {
+        spots.renew(index, currentTime, PARKING_DURATION);
+        markSpotDirty(index);
+    }
+    else if (occupied && action == SpotAction::Release) {
+        spots.release(index);
+        markSpotDirty(index);
+
+        playSound(SceneSound::Leaving);
+    }
+}
+
+void ParkingScene::parkCar(int index, const std::string& licensePlate, const std::string& driverName, const float carColor[3]) {
+    spots.occupy(index, currentTime, PARKING_DURATION, licensePlate, driverName, carColor);
+    markSpotDirty(index);
+
+    playSound(SceneSound::Parking);
+}
+
+void ParkingScene::click(float x, float y) {
+    // Blink light of an expired spot, clicking it lets the car leave
+    int index = layout.findIndicator(x, y);
+    if (index != -1 && spots.has(index, SpotStore::BLINKING)) {
+        spots.release(index);
+        markSpotDirty(index);
+
+        playSound(SceneSound::Leaving);
+    }
+
+    // Clicking a car toggles its information
+    index = layout.findCar(x, y);
+    if (index != -1 && spots.has(index, SpotStore::OCCUPIED)) {
+        toggleInfo(index);
+    }
+}
+
+void ParkingScene::toggleInfo(int index) {
+    spots.set(index, SpotStore::SHOW_INFO, !spots.has(index, SpotStore::SHOW_INFO));
+    markSpotDirty(index);
+}
+
+// Creates the retained layers, one slot per parking spot
+void ParkingScene::createScene() {
+    int spotCount = layout.getSpotCount();
+    spots.resize(spotCount);
+    spotNodes.resize(spotCount);
+    spotRedraws.resize(spotCount);
+    carLayer = renderer->createLayer(Renderer::Primitive::Sprite, spotCount, assetLoader->getRegion(carSprite).texture);
+    infoBoxLayer = renderer->createLayer(Renderer::Primitive::Rectangle, spotCount);
+    indicatorLayer = renderer->createLayer(Renderer::Primitive::Circle, spotCount);
+    timerLayer = renderer->createLayer(Renderer::Primitive::Timer, spotCount);
+    spotTextLayer = renderer->createLayer(Renderer::Primitive::Text, spotCount);
+    markLayoutDirty();
+}
+
+// Rebuilds the geometry of one spot into its slots of the retained layers
+void ParkingScene::buildSpotNode(int index) {
+    const SpotGeometry& spot = layout.getSpot(index);
+    SpotDetails& details = spots.details[index];
+    bool occupied = spots.has(index, SpotStore::OCCUPIED);
+    bool showInfo = occupied && spots.has(index, SpotStore::SHOW_INFO);
+    bool blinking = spots.has(index, SpotStore::BLINKING);
+
+    glm::vec4 textColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+
+    // Draw the car if the spot is occupied, faded out while its information is shown
+    renderer->beginLayerSlot(carLayer, index);
+    if (occupied) {
+        glm::vec3 blendColor = glm::vec3(details.carColor[0], details.carColor[1], details.carColor[2]);
+        float carAlpha = showInfo ? 0.6f : 1.0f;
+        renderer->submitSprite(assetLoader->getRegion(carSprite), spot.carX, spot.carY, spot.carWidth, spot.carHeight, spot.rotation, carAlpha, blendColor);
+    }
+    renderer->endLayerSlot();
+
+    // Draw the car information box, its text goes into the text slot below
+    float labelBoxXCoord = 0.0f;
+    renderer->beginLayerSlot(infoBoxLayer, index);
+    if (showInfo) {
+        renderer->layoutText(details.licensePlateLayout, details.licensePlate, 0.5f);
+        renderer->layoutText(details.driverNameLayout, details.driverName, 0.5f);
+        float licensePlateWidth = details.licensePlateLayout.getWidth();
+        float driverNameWidth = details.driverNameLayout.getWidth();
+        float maxWidth = std::max(licensePlateWidth, driverNameWidth);
+        float blackColor[4] = { 0.0f, 0.0f, 0.0f, 0.4f };
+        labelBoxXCoord = spot.carX + spot.carWidth / 2 - ((maxWidth + 10.0f) / 2);
+        renderer->submitRectangle(labelBoxXCoord, spot.y + 30.0f, maxWidth + 10.0f, 52.0f, blackColor);
+    }
+    renderer->endLayerSlot();
+
+    renderer->beginLayerSlot(spotTextLayer, index);
+    if (showInfo) {
+        renderer->submitText(details.licensePlateLayout, labelBoxXCoord + 5.0f, spot.y + 35.0f, textColor);
+        renderer->submitText(details.driverNameLayout, labelBoxXCoord + 5.0f, spot.y + 60.0f, textColor);
+    }
+    renderer->endLayerSlot();
+
+    // Draw the spot indicator, the blink light replaces the timer
+    float indicatorBorderColor[3] = { 1.0f, 1.0f, 1.0f };
+    renderer->beginLayerSlot(indicatorLayer, index);
+    renderer->submitCircle(spot.indicatorX, spot.indicatorY, 37.0f, indicatorBorderColor);
+    if (blinking) {
+        float blinkColor[3];
+        spots.getBlinkColor(index, blinkColor);
+        renderer->submitCircle(spot.indicatorX, spot.indicatorY, 35.0f, blinkColor);
+    }
+    renderer->endLayerSlot();
+
+    renderer->beginLayerSlot(timerLayer, index);
+    if (!blinking) {
+        // Derived from the deadline, the ring is rebuilt once the sweep finds it on the next visible step
+        float progress = spots.getProgress(index, currentTime);
+        renderer->submitParkingSpotTimer(spot.indicatorX, spot.indicatorY, 35.0f, progress);
+    }
+    spots.drawnSteps[index] = spots.getRingStep(index, currentTime, PROGRESS_STEPS);
+    if (!blinking) {
+        spotRedraws.cancel(index);
+    }
+    renderer->endLayerSlot();
+}
+
+// Redraws the background, the empty parking spaces and their labels into the static layer
+void ParkingScene::renderStaticLayer() {
+    PROFILE_SCOPE("static layer redraw");
+    renderer->beginStaticLayer(width, height);
+
+    // Draw the background
+    renderer->renderImage(assetLoader->getRegion(backgroundSprite), 0.0f, 0.0f, width, height, 0.0f, 1.0f, {1.0f, 1.0f, 1.0f});
+
+    // Draw the parking spaces
+    renderer->beginSprites();
+    for (int index = 0; index < layout.getSpotCount(); ++index) {
+        const SpotGeometry& spot = layout.getSpot(index);
+        renderer->submitSprite(assetLoader->getRegion(parkingSpotSprite), spot.x, spot.y, spot.width, spot.height, spot.rotation, 1.0f, { 1.0f, 1.0f, 1.0f });
+    }
+    renderer->flushSprites();
+
+    // Draw the parking spot labels
+    glm::vec4 textColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    renderer->beginText();
+    for (int index = 0; index < layout.getSpotCount(); ++index) {
+        const SpotGeometry& spot = layout.getSpot(index);
+        SpotDetails& details = spots.details[index];
+        renderer->layoutText(details.labelLayout, layout.getSpotName(index), 0.5f);
+        float labelWidth = details.labelLayout.getWidth();
+        renderer->submitText(details.labelLayout, spot.labelX - labelWidth, spot.labelY, textColor);
+    }
+    renderer->flushText();
+
+    renderer->endStaticLayer();
+}
+
+// Rebuilds only the spots whose visible state changed
+void ParkingScene::updateScene() {
+    PROFILE_SCOPE("scene update");
+    for (int index : dirtySpots) {
+        buildSpotNode(index);
+        spotNodes[index].dirty = false;
+    }
+    dirtySpots.clear();
+}
+
+void ParkingScene::render() {
+    PROFILE_SCOPE("render");
+    // Swap in the sprites that finished decoding, before the frame starts tracking GL state. They are
+    // counted rather than taken from update(), the loader may have been drained outside the scene.
+    assetLoader->update();
+    int ready = countReadySprites();
+    if (ready != readySprites) {
+        readySprites = ready;
+        renderer->setLayerTexture(carLayer, assetLoader->getRegion(carSprite).texture);
+        markLayoutDirty();
+    }
+
+    renderer->beginFrame();
+
+    // Copy the background and the empty parking spaces, the blit covers the whole window
+    if (staticLayerDirty && width > 0 && height > 0) {
+        renderStaticLayer();
+        staticLayerDirty = false;
+    }
+    renderer->drawStaticLayer();
+
+    // Draw the parking spot contents from the retained scene, one call per layer
+    updateScene();
+    renderer->drawLayer(carLayer);
+    renderer->drawLayer(infoBoxLayer);
+    renderer->drawLayer(indicatorLayer);
+    renderer->drawLayer(timerLayer);
+    renderer->drawLayer(spotTextLayer);
+
+    // Draw the title
+    renderer->beginText();
+    renderer->layoutText(parkingTitleLayout, "PARKING", 1.0f);
+    renderer->layoutText(servisTitleLayout, "SERVIS", 1.0f);
+    float titleWidth = parkingTitleLayout.getWidth();
+    float blackColor[4] = { 0.0f, 0.0f, 0.0f, 0.4f };
+    renderer->drawRectangle(width / 2 - (titleWidth / 2) - 5.0f, height - 65.0f, titleWidth + 10.0f, 48.0f, blackColor);
+
+    float alpha1 = displayParking ? (1.0f - titleTextTransitionProgress) : titleTextTransitionProgress;
+    float alpha2 = 1.0f - alpha1;
+
+    if (!displayParking) {
+        glm::vec4 titleTextColorVec = glm::vec4(titleTextColor[0], titleTextColor[1], titleTextColor[2], alpha1);
+        float widthDiff = parkingTitleLayout.getWidth() - servisTitleLayout.getWidth();
+        renderer->submitText(servisTitleLayout, width / 2 - (titleWidth / 2) + (widthDiff / 2), height - 58.0f, titleTextColorVec);
+    }
+    else {
+        glm::vec4 titleTextColorVec = glm::vec4(titleTextColor[0], titleTextColor[1], titleTextColor[2], alpha2);
+        renderer->submitText(parkingTitleLayout, width / 2 - (titleWidth / 2), height - 58.0f, titleTextColorVec);
+    }
+
+    renderer->layoutText(authorLayout, "Vuk Dimitrov SV52/2021", 0.5f);
+    float additionalTextWidth = authorLayout.getWidth();
+    glm::vec4 studentNameTextColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    renderer->submitText(authorLayout, width - additionalTextWidth - 5.0f, height - 25.0f, studentNameTextColor);
+
+    renderer->flushText();
+}
+
+void ParkingScene::update(float now) {
+    PROFILE_SCOPE("update");
+    currentTime = now;
+    float deltaTime = currentTime - lastTime;
+    lastTime = currentTime;
+
+    // Spots whose time ran out, the wheel only hands out the due ones
+    dueSpots.clear();
+    spots.collectExpired(currentTime, dueSpots);
+    for (uint32_t i : dueSpots) {
+        // Print the expired parking information
+        if (!spots.has(i, SpotStore::BLINKING)) {
+            tm localTime = getLocalTime(time(0));
+            std::cout << "Parking spot " << layout.getSpotName(i) << " expired at "
+                << localTime.tm_hour << ":" << localTime.tm_min << ":"
+                << localTime.tm_sec << " with vehicle: " << spots.details[i].licensePlate << std::endl;
+
+            if (spots.has(i, SpotStore::TIMER_SOUND)) {
+                playSound(SceneSound::Indicator);
+                spots.set(i, SpotStore::TIMER_SOUND, false);
+            }
+            markSpotDirty(i);
+        }
+        spots.set(i, SpotStore::BLINKING, true);
+        spotRedraws.schedule(i, currentTime + BLINK_INTERVAL);
+    }
+
+    // Timer rings that reached their next step, the kernel sets the bits and only those are visited
+    spots.findRingRedraws(currentTime, PROGRESS_STEPS, ringRedraws, &pool);
+    for (size_t word = 0; word < ringRedraws.size(); ++word) {
+        for (uint64_t bits = ringRedraws[word]; bits != 0; bits &= bits - 1) {
+            markSpotDirty(static_cast<int>(word * 64 + findLowestBit(bits)));
+        }
+    }
+
+    // Blink lights due to toggle
+    dueSpots.clear();
+    spotRedraws.advance(currentTime, dueSpots);
+    for (uint32_t i : dueSpots) {
+        if (spots.has(i, SpotStore::BLINKING)) {
+            spots.flags[i] ^= SpotStore::BLINK_LIT;
+            spotRedraws.schedule(i, currentTime + BLINK_INTERVAL);
+        }
+        markSpotDirty(i);
+    }
+
+    // Update title text animation
+    if (reverseTransition) {
+        titleTextTransitionProgress -= deltaTime / TITLE_TRANSITION_DURATION;
+    }
+    else {
+        titleTextTransitionProgress += deltaTime / TITLE_TRANSITION_DURATION;
+    }
+
+    if (titleTextTransitionProgress >= 1.0f) {
+        titleTextTransitionProgress = 1.0f;
+        reverseTransition = true;
+    }
+    else if (titleTextTransitionProgress <= 0.0f) {
+        titleTextTransitionProgress = 0.0f;
+        reverseTransition = false;
+        displayParking = !displayParking;
+        // Set new target color
+        targetTitleTextColor[0] = 0.25f + static_cast<float>(rand()) / (RAND_MAX / 0.75f);
+        targetTitleTextColor[1] = 0.25f + static_cast<float>(rand()) / (RAND_MAX / 0.75f);
+        targetTitleTextColor[2] = 0.25f + static_cast<float>(rand()) / (RAND_MAX / 0.75f);
+    }
+
+    // Interpolate text color
+    titleTextColor[0] += (targetTitleTextColor[0] - titleTextColor[0]) * deltaTime * 2;
+    titleTextColor[1] += (targetTitleTextColor[1] - titleTextColor[1]) * deltaTime * 2;
+    titleTextColor[2] += (targetTitleTextColor[2] - titleTextColor[2]) * deltaTime * 2;
+}
@@ -0,0 +1,128 @@
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "LotLayout.h"
+#include "Rendering.h"
+#include "SpotStore.h"
+#include "TaskPool.h"
+#include "TimerWheel.h"
+
+#ifndef PARKING_SCENE_H
+#define PARKING_SCENE_H
+
+// Assets are read from the pack when it exists, from the loose files otherwise
+const char* const ASSET_PACK_PATH = "assets.pack";
+// Rows, columns and spacing of the lot, the built-in layout is used without it
+const char* const LOT_CONFIG_PATH = "lot.cfg";
+
+// Seconds a car may stay before its spot expires
+const float PARKING_DURATION = 20.0f;
+
+enum class SceneSound {
+    Parking,
+    Leaving,
+    Indicator
+};
+
+// What a key press does to a spot: park a car in a free spot, restart the time of an occupied one, or free it
+enum class SpotAction {
+    Park,
+    Renew,
+    Release
+};
+
+// The parking lot without a window or sound: spot state, the retained scene and the title.
+// The window build feeds it input and plays its sounds, the headless tool and the tests drive it directly.
+// Times are in seconds on the caller's clock, which starts at 0.
+class ParkingScene {
+public:
+    // Starts decoding the sprites, they show as placeholders until they are ready
+    ParkingScene(RenderBackend& backend, TaskPool& pool, const AssetPack* pack, const LotLayout& layout, int width, int height);
+    ~ParkingScene();
+
+    Renderer& getRenderer() { return *renderer; }
+    const LotLayout& getLayout() const { return layout; }
+    SpotStore& getSpots() { return spots; }
+    AssetLoader& getAssetLoader() { return *assetLoader; }
+
+    // Called for every sound the scene wants played, nothing plays without it
+    void setSoundCallback(const std::function<void(SceneSound)>& callback) { soundCallback = callback; }
+
+    void resize(int width, int height);
+
+    // A car with random details parks, stays longer or leaves, depending on the action and the spot
+    void handleSpotAction(int index, SpotAction action);
+    void parkCar(int index, const std::string& licensePlate, const std::string& driverName, const float carColor[3]);
+    // Clicks the blink light of an expired spot to let its car leave, or a car to toggle its information
+    void click(float x, float y);
+    void toggleInfo(int index);
+
+    void update(float now);
+    void render();
+
+    void markSpotDirty(int index);
+
+private:
+    // Retained scene: one node per parking spot, its geometry stays on the GPU and is
+    // only rebuilt when the node is marked dirty
+    struct SpotNode {
+        bool dirty = false;
+    };
+
+    TaskPool& pool;
+    Renderer* renderer;
+    TextureAtlas* spriteAtlas;
+    AssetLoader* assetLoader;
+    int carSprite;
+    int parkingSpotSprite;
+    int backgroundSprite;
+    // Sprites whose image was in when the scene was last rebuilt
+    int readySprites;
+
+    int width, height;
+    LotLayout layout;
+    SpotStore spots;
+    std::function<void(SceneSound)> soundCallback;
+
+    float currentTime, lastTime;
+    std::vector<SpotNode> spotNodes;
+    // Nodes marked dirty since the last update, each listed once
+    std::vector<int> dirtySpots;
+    // When each blink light next toggles
+    TimerWheel spotRedraws;
+    std::vector<uint32_t> dueSpots;
+    // Spots whose timer ring moved a step since it was drawn, a bit per spot
+    std::vector<uint64_t> ringRedraws;
+
+    int carLayer, infoBoxLayer, indicatorLayer, timerLayer, spotTextLayer;
+
+    // Background, bays and spot labels only change with the layout, they are drawn into
+    // the static layer cache and copied to the window every frame
+    bool staticLayerDirty;
+
+    // Title animation
+    bool displayParking;
+    float titleTextColor[3];
+    float targetTitleTextColor[3];
+    float titleTextTransitionProgress;
+    bool reverseTransition;
+
+    // Cached layouts of the static strings
+    Renderer::TextLayout parkingTitleLayout;
+    Renderer::TextLayout servisTitleLayout;
+    Renderer::TextLayout authorLayout;
+
+    void playSound(SceneSound sound);
+    int countReadySprites() const;
+    void markSceneDirty();
+    void markLayoutDirty();
+    void createScene();
+    void buildSpotNode(int index);
+    void renderStaticLayer();
+    void updateScene();
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+struct ProfileEvent {
+    const char* name;
+    // Enclosing scope on the same thread, null at the top
+    const char* parent;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Written by its own thread only. The count is stored after the event, so a reader sees whole events.
+struct ThreadBuffer {
+    std::vector<ProfileEvent> events;
+    std::atomic<size_t> written;
+    uint32_t id;
+    std::string name;
+};
+
+// Deeper scopes are still timed, they just report the deepest tracked one as their parent
+static const int MAX_DEPTH = 64;
+
+static std::mutex buffersMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+static thread_local ThreadBuffer* threadBuffer = nullptr;
+static thread_local const char* scopeStack[MAX_DEPTH];
+static thread_local int scopeDepth = 0;
+
+std::atomic<bool> Profiler::enabled(false);
+
+static uint64_t getTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+// The buffers live until the program exits, so the trace still has the threads that already finished
+static ThreadBuffer& getThreadBuffer() {
+    if (!threadBuffer) {
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        buffer->events.resize(Profiler::EVENTS_PER_THREAD);
+        buffer->written = 0;
+
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffer->id = static_cast<uint32_t>(buffers.size() + 1);
+        buffer->name = "thread " + std::to_string(buffer->id);
+        threadBuffer = buffer.get();
+        buffers.push_back(std::move(buffer));
+    }
+    return *threadBuffer;
+}
+
+void Profiler::setEnabled(bool enabled) {
+    Profiler::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    ThreadBuffer& buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffer.name = name;
+}
+
+uint64_t Profiler::beginScope(const char* name) {
+    getThreadBuffer();
+    if (scopeDepth < MAX_DEPTH) {
+        scopeStack[scopeDepth] = name;
+    }
+    scopeDepth++;
+    return getTime();
+}
+
+void Profiler::endScope(const char* name, uint64_t start) {
+    uint64_t end = getTime();
+    scopeDepth--;
+
+    ThreadBuffer& buffer = getThreadBuffer();
+    size_t written = buffer.written.load(std::memory_order_relaxed);
+    ProfileEvent& event = buffer.events[written % EVENTS_PER_THREAD];
+    event.name = name;
+    event.parent = scopeDepth > 0 ? scopeStack[std::min(scopeDepth, MAX_DEPTH) - 1] : nullptr;
+    event.start = start;
+    event.end = end;
+    buffer.written.store(written + 1, std::memory_order_release);
+}
+
+// Calls fn with every event still in the ring buffers
+template <typename Function>
+static void forEachEvent(Function fn) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+        size_t written = buffer->written.load(std::memory_order_acquire);
+        size_t first = written > Profiler::EVENTS_PER_THREAD ? written - Profiler::EVENTS_PER_THREAD : 0;
+        for (size_t i = first; i < written; ++i) {
+            fn(*buffer, buffer->events[i % Profiler::EVENTS_PER_THREAD]);
+        }
+    }
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "ERROR::PROFILER: Could not write " << path << std::endl;
+        return false;
+    }
+
+    // Timestamps and durations are in microseconds, see the Trace Event Format
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+            out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+            first = false;
+        }
+    }
+
+    out << std::fixed << std::setprecision(3);
+    forEachEvent([&](const ThreadBuffer& buffer, const ProfileEvent& event) {
+        out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.id
+            << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+        first = false;
+    });
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+void Profiler::printSummary(std::ostream& out) {
+    // Durations per scope and parent, merged over the threads
+    typedef std::pair<std::string, std::string> ScopeKey;
+    std::map<ScopeKey, std::vector<uint64_t>> durations;
+    forEachEvent([&](const ThreadBuffer&, const ProfileEvent& event) {
+        durations[ScopeKey(event.parent ? event.parent : "", event.name)].push_back(event.end - event.start);
+    });
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::left << std::setw(32) << "scope" << std::right << std::setw(10) << "calls"
+        << std::setw(10) << "min ms" << std::setw(10) << "avg ms" << std::setw(10) << "p99 ms" << std::setw(10) << "max ms" << "\n";
+    out << std::fixed << std::setprecision(3);
+
+    // Depth first from the top level scopes, a scope already on the path is not entered again
+    std::set<std::string> path;
+    std::function<void(const std::string&, int)> printChildren = [&](const std::string& parent, int depth) {
+        for (auto& entry : durations) {
+            if (entry.first.first != parent || path.count(entry.first.second)) {
+                continue;
+            }
+
+            std::vector<uint64_t>& times = entry.second;
+            std::sort(times.begin(), times.end());
+            uint64_t total = 0;
+            for (uint64_t time : times) {
+                total += time;
+            }
+            size_t p99 = (times.size() * 99 + 99) / 100 - 1;
+
+            out << std::left << std::setw(32) << (std::string(depth * 2, ' ') + entry.first.second) << std::right
+                << std::setw(10) << times.size()
+                << std::setw(10) << times.front() / 1e6
+                << std::setw(10) << total / 1e6 / times.size()
+                << std::setw(10) << times[p99] / 1e6
+                << std::setw(10) << times.back() / 1e6 << "\n";
+
+            path.insert(entry.first.second);
+            printChildren(entry.first.second, depth + 1);
+            path.erase(entry.first.second);
+        }
+    };
+    printChildren("", 0);
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+        buffer->written = 0;
+    }
+}
+
+std::string Profiler::parseArguments(int& argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) != "--profile") {
+            continue;
+        }
+
+        int used = 1;
+        std::string tracePath = "trace.json";
+        if (i + 1 < argc && argv[i + 1][0] != '-') {
+            tracePath = argv[i + 1];
+            used = 2;
+        }
+        std::copy(argv + i + used, argv + argc, argv + i);
+        argc -= used;
+
+        setThreadName("main");
+        setEnabled(true);
+        return tracePath;
+    }
+    return "";
+}
+
+void Profiler::finish(const std::string& tracePath) {
+    if (tracePath.empty()) {
+        return;
+    }
+
+    setEnabled(false);
+    if (writeChromeTrace(tracePath)) {
+        std::cout << "Trace written to " << tracePath << std::endl;
+    }
+    printSummary(std::cout);
+}
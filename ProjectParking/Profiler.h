@@ -0,0 +1,74 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped CPU timing markers. Every thread records into a ring buffer of its own, so a marker takes no lock,
+// and while the profiler is disabled a marker is a single flag test. Scopes nest, the summary keeps the tree.
+class Profiler {
+public:
+    // Events kept per thread, the oldest are overwritten once it is full
+    static const size_t EVENTS_PER_THREAD = 1 << 16;
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    // Name of the calling thread in the trace
+    static void setThreadName(const std::string& name);
+
+    // Start time of a scope opened on the calling thread, in nanoseconds since the profiler started
+    static uint64_t beginScope(const char* name);
+    static void endScope(const char* name, uint64_t start);
+
+    // Read the events while the profiled threads are idle, e.g. after the last frame
+    static bool writeChromeTrace(const std::string& path);
+    // Call count and min, average, 99th percentile and max duration of every scope, children indented below their parent
+    static void printSummary(std::ostream& out);
+    static void clear();
+
+    // Takes --profile and its optional trace path out of the arguments and starts recording on the calling thread.
+    // Returns the trace path, empty when not profiling.
+    static std::string parseArguments(int& argc, char* argv[]);
+    // Writes the trace and prints the summary, nothing for an empty path
+    static void finish(const std::string& tracePath);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+// Times the enclosing block. The name must outlive the profiler, string literals are the norm.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : name(Profiler::isEnabled() ? name : nullptr), start(0) {
+        if (this->name) {
+            start = Profiler::beginScope(this->name);
+        }
+    }
+
+    ~ProfileScope() {
+        if (name) {
+            Profiler::endScope(name, start);
+        }
+    }
+
+private:
+    ProfileScope(const ProfileScope&);
+    ProfileScope& operator=(const ProfileScope&);
+
+    const char* name;
+    uint64_t start;
+};
+
+// Defining PARKING_NO_PROFILER compiles the markers out entirely
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#ifdef PARKING_NO_PROFILER
+#define PROFILE_SCOPE(name)
+#else
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#endif
+
+#endif
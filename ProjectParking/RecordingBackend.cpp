@@ -0,0 +1,198 @@
+#include "RecordingBackend.h"
+#include <algorithm>
+#include <cstring>
+
+const GLuint RecordingBackend::STREAM_BUFFER;
+
+RecordingBackend::RecordingBackend() : nextBuffer(STREAM_BUFFER + 1), nextTexture(1), viewportWidth(0), viewportHeight(0), clearColor(0.0f), projection(1.0f) {
+    buffers[STREAM_BUFFER];
+}
+
+const std::vector<RecordedCommand>& RecordingBackend::getCommands() const {
+    return commands;
+}
+
+const RecordingStats& RecordingBackend::getStats() const {
+    return stats;
+}
+
+void RecordingBackend::clear() {
+    commands.clear();
+    stats = RecordingStats();
+}
+
+const std::vector<unsigned char>& RecordingBackend::getBufferData(GLuint buffer) const {
+    static const std::vector<unsigned char> empty;
+    auto it = buffers.find(buffer);
+    return it != buffers.end() ? it->second : empty;
+}
+
+const std::vector<unsigned char>& RecordingBackend::getTexturePixels(GLuint texture) const {
+    static const std::vector<unsigned char> empty;
+    auto it = textures.find(texture);
+    return it != textures.end() ? it->second.pixels : empty;
+}
+
+const TextureDesc* RecordingBackend::getTextureDesc(GLuint texture) const {
+    auto it = textures.find(texture);
+    return it != textures.end() ? &it->second.desc : nullptr;
+}
+
+int RecordingBackend::getViewportWidth() const {
+    return viewportWidth;
+}
+
+int RecordingBackend::getViewportHeight() const {
+    return viewportHeight;
+}
+
+const glm::vec4& RecordingBackend::getClearColor() const {
+    return clearColor;
+}
+
+const glm::mat4& RecordingBackend::getProjectionMatrix() const {
+    return projection;
+}
+
+void RecordingBackend::print(std::ostream& out) const {
+    static const char* primitiveNames[] = { "rectangle", "circle", "timer", "sprite", "text" };
+
+    for (const RecordedCommand& command : commands) {
+        switch (command.type) {
+        case RecordedCommandType::Draw:
+            out << "draw " << primitiveNames[static_cast<int>(command.call.primitive)]
+                << " buffer " << command.call.buffer << " offset " << command.call.offset
+                << " count " << command.call.count << " texture " << command.call.texture
+                << " vertices " << command.vertices << "\n";
+            break;
+        case RecordedCommandType::BeginOffscreen:
+            out << "begin offscreen " << command.width << "x" << command.height << "\n";
+            break;
+        case RecordedCommandType::EndOffscreen:
+            out << "end offscreen\n";
+            break;
+        case RecordedCommandType::DrawOffscreen:
+            out << "draw offscreen\n";
+            break;
+        }
+    }
+}
+
+void RecordingBackend::beginFrame() {
+    stats.frames++;
+    commands.clear();
+    buffers[STREAM_BUFFER].clear();
+}
+
+void RecordingBackend::setViewport(int width, int height) {
+    viewportWidth = width;
+    viewportHeight = height;
+}
+
+void RecordingBackend::setClearColor(const glm::vec4& color) {
+    clearColor = color;
+}
+
+void RecordingBackend::setProjectionMatrix(const glm::mat4& projection) {
+    this->projection = projection;
+}
+
+GLuint RecordingBackend::getStreamBuffer() const {
+    return STREAM_BUFFER;
+}
+
+size_t RecordingBackend::appendStream(const void* data, size_t size, size_t alignment) {
+    std::vector<unsigned char>& stream = buffers[STREAM_BUFFER];
+    size_t offset = (stream.size() + alignment - 1) / alignment * alignment;
+    stream.resize(offset + size);
+    memcpy(stream.data() + offset, data, size);
+    stats.bytesUploaded += size;
+    return offset;
+}
+
+GLuint RecordingBackend::createBuffer(size_t size) {
+    GLuint buffer = nextBuffer++;
+    buffers[buffer].assign(size, 0);
+    return buffer;
+}
+
+void RecordingBackend::updateBuffer(GLuint buffer, size_t offset, const void* data, size_t size) {
+    std::vector<unsigned char>& storage = buffers[buffer];
+    if (offset + size > storage.size()) {
+        return;
+    }
+    memcpy(storage.data() + offset, data, size);
+    stats.bytesUploaded += size;
+}
+
+void RecordingBackend::deleteBuffer(GLuint buffer) {
+    buffers.erase(buffer);
+}
+
+GLuint RecordingBackend::createTexture() {
+    GLuint texture = nextTexture++;
+    textures[texture] = Texture();
+    return texture;
+}
+
+void RecordingBackend::uploadTexture(GLuint texture, const TextureDesc& desc, const unsigned char* const* levels) {
+    Texture& target = textures[texture];
+    target.desc = desc;
+
+    size_t pixelSize = desc.format == TextureFormat::RGBA ? 4 : 1;
+    target.pixels.assign(levels[0], levels[0] + static_cast<size_t>(desc.width) * desc.height * pixelSize);
+    for (int level = 0; level < desc.levelCount; ++level) {
+        size_t levelWidth = std::max(1, desc.width >> level);
+        size_t levelHeight = std::max(1, desc.height >> level);
+        stats.textureBytesUploaded += levelWidth * levelHeight * pixelSize;
+    }
+}
+
+void RecordingBackend::deleteTexture(GLuint texture) {
+    textures.erase(texture);
+}
+
+void RecordingBackend::draw(const DrawCall& call) {
+    RecordedCommand command = {};
+    command.type = RecordedCommandType::Draw;
+    command.call = call;
+
+    // Vertices the GL backend would process for the call
+    switch (call.primitive) {
+    case RenderPrimitive::Rectangle:
+    case RenderPrimitive::Text:
+        command.vertices = call.count;
+        break;
+    case RenderPrimitive::Circle:
+        command.vertices = static_cast<size_t>(call.count) * (CIRCLE_SEGMENTS + 2);
+        break;
+    case RenderPrimitive::Timer:
+    case RenderPrimitive::Sprite:
+        command.vertices = static_cast<size_t>(call.count) * 6;
+        break;
+    }
+
+    commands.push_back(command);
+    stats.drawCalls++;
+    stats.vertices += command.vertices;
+}
+
+void RecordingBackend::beginOffscreen(int width, int height) {
+    RecordedCommand command = {};
+    command.type = RecordedCommandType::BeginOffscreen;
+    command.width = width;
+    command.height = height;
+    commands.push_back(command);
+}
+
+void RecordingBackend::endOffscreen() {
+    RecordedCommand command = {};
+    command.type = RecordedCommandType::EndOffscreen;
+    commands.push_back(command);
+}
+
+void RecordingBackend::drawOffscreen() {
+    RecordedCommand command = {};
+    command.type = RecordedCommandType::DrawOffscreen;
+    commands.push_back(command);
+}
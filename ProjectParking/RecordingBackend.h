@@ -0,0 +1,100 @@
+#include <cstddef>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "RenderBackend.h"
+
+#ifndef RECORDING_BACKEND_H
+#define RECORDING_BACKEND_H
+
+enum class RecordedCommandType {
+    Draw,
+    BeginOffscreen,
+    EndOffscreen,
+    DrawOffscreen
+};
+
+struct RecordedCommand {
+    RecordedCommandType type;
+    // Draws only
+    DrawCall call;
+    size_t vertices;
+    // Offscreen target size, BeginOffscreen only
+    int width, height;
+};
+
+// Totals since the backend was created
+struct RecordingStats {
+    unsigned int frames = 0;
+    unsigned int drawCalls = 0;
+    size_t vertices = 0;
+    size_t bytesUploaded = 0;
+    size_t textureBytesUploaded = 0;
+};
+
+// Keeps buffers and textures in memory and records the commands of the current frame instead of drawing them.
+// Needs no window or GL context, so the whole frame can run headless for tests and benchmarks.
+class RecordingBackend : public RenderBackend {
+public:
+    RecordingBackend();
+
+    // Commands since the last beginFrame
+    const std::vector<RecordedCommand>& getCommands() const;
+    const RecordingStats& getStats() const;
+    void clear();
+
+    const std::vector<unsigned char>& getBufferData(GLuint buffer) const;
+    // Level 0 of the texture, empty if nothing was uploaded
+    const std::vector<unsigned char>& getTexturePixels(GLuint texture) const;
+    const TextureDesc* getTextureDesc(GLuint texture) const;
+    int getViewportWidth() const;
+    int getViewportHeight() const;
+    const glm::vec4& getClearColor() const;
+    const glm::mat4& getProjectionMatrix() const;
+
+    // One line per command of the current frame
+    void print(std::ostream& out) const;
+
+    void beginFrame() override;
+    void setViewport(int width, int height) override;
+    void setClearColor(const glm::vec4& color) override;
+    void setProjectionMatrix(const glm::mat4& projection) override;
+
+    GLuint getStreamBuffer() const override;
+    size_t appendStream(const void* data, size_t size, size_t alignment) override;
+
+    GLuint createBuffer(size_t size) override;
+    void updateBuffer(GLuint buffer, size_t offset, const void* data, size_t size) override;
+    void deleteBuffer(GLuint buffer) override;
+
+    GLuint createTexture() override;
+    void uploadTexture(GLuint texture, const TextureDesc& desc, const unsigned char* const* levels) override;
+    void deleteTexture(GLuint texture) override;
+
+    void draw(const DrawCall& call) override;
+
+    void beginOffscreen(int width, int height) override;
+    void endOffscreen() override;
+    void drawOffscreen() override;
+
+private:
+    static const GLuint STREAM_BUFFER = 1;
+
+    struct Texture {
+        TextureDesc desc;
+        std::vector<unsigned char> pixels;
+    };
+
+    std::unordered_map<GLuint, std::vector<unsigned char>> buffers;
+    std::unordered_map<GLuint, Texture> textures;
+    GLuint nextBuffer;
+    GLuint nextTexture;
+
+    std::vector<RecordedCommand> commands;
+    RecordingStats stats;
+    int viewportWidth, viewportHeight;
+    glm::vec4 clearColor;
+    glm::mat4 projection;
+};
+
+#endif
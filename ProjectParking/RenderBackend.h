@@ -0,0 +1,122 @@
+#include <cstddef>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+enum class RenderPrimitive {
+    Rectangle,
+    Circle,
+    Timer,
+    Sprite,
+    Text
+};
+
+// Record layouts the renderer writes and every backend reads
+
+// Rectangle corner, rectangles are drawn as two triangles of 6 vertices
+struct ColorVertex {
+    float x, y;
+    float r, g, b, a;
+};
+
+// Glyph quad corner, 6 vertices per glyph, colored per vertex so strings of any color share a draw
+struct TextVertex {
+    float x, y;
+    float u, v;
+    float r, g, b, a;
+};
+
+// One instance of the unit quad, scaled, rotated around its center and tinted
+struct SpriteInstance {
+    float x, y, width, height;
+    float u0, v0, u1, v1;
+    float rotation, alpha;
+    float r, g, b;
+};
+
+// Unit circle drawn as a triangle fan, scaled and colored per instance
+const int CIRCLE_SEGMENTS = 360;
+
+struct CircleInstance {
+    float cx, cy, r;
+    float red, green, blue, alpha;
+};
+
+// Progress ring drawn as a quad, green and red split by the progress
+struct TimerInstance {
+    float cx, cy, r;
+    float redProgress;
+};
+
+enum class TextureFormat {
+    Red,
+    RGBA
+};
+
+// Tightly packed levels, each half the size of the previous one. Levels between levelCount
+// and maxLevel are generated from the given ones.
+struct TextureDesc {
+    TextureFormat format;
+    int width, height;
+    int levelCount;
+    int maxLevel;
+    bool nearest;
+};
+
+struct DrawCall {
+    RenderPrimitive primitive;
+    GLuint buffer;
+    // Byte offset of the first record in the buffer
+    size_t offset;
+    // Vertices for rectangles and text, instances otherwise
+    GLsizei count;
+    // Sprite image or glyph atlas
+    GLuint texture;
+    // Text only: the glyph atlas holds distance fields
+    bool distanceField;
+};
+
+// Everything the Renderer needs from a graphics API. Buffer and texture ids come from the backend,
+// 0 is never a valid one.
+class RenderBackend {
+public:
+    virtual ~RenderBackend() {}
+
+    virtual void beginFrame() = 0;
+    virtual void setViewport(int width, int height) = 0;
+    virtual void setClearColor(const glm::vec4& color) = 0;
+    virtual void setProjectionMatrix(const glm::mat4& projection) = 0;
+
+    // Per-frame records: appended to the stream buffer and valid until the next beginFrame
+    virtual GLuint getStreamBuffer() const = 0;
+    virtual size_t appendStream(const void* data, size_t size, size_t alignment) = 0;
+
+    // Retained records, a new buffer is zeroed
+    virtual GLuint createBuffer(size_t size) = 0;
+    virtual void updateBuffer(GLuint buffer, size_t offset, const void* data, size_t size) = 0;
+    virtual void deleteBuffer(GLuint buffer) = 0;
+
+    virtual GLuint createTexture() = 0;
+    virtual void uploadTexture(GLuint texture, const TextureDesc& desc, const unsigned char* const* levels) = 0;
+    virtual void deleteTexture(GLuint texture) = 0;
+
+    virtual void draw(const DrawCall& call) = 0;
+
+    // Offscreen target: draws in between go into it, drawOffscreen copies it to the screen
+    virtual void beginOffscreen(int width, int height) = 0;
+    virtual void endOffscreen() = 0;
+    virtual void drawOffscreen() = 0;
+};
+
+// Levels of a full mip chain down to 1x1
+inline int getMipLevelCount(int width, int height) {
+    int levels = 1;
+    while ((width >> levels) > 0 || (height >> levels) > 0) {
+        levels++;
+    }
+    return levels;
+}
+
+#endif
@@ -1,4 +1,9 @@
 #include "Rendering.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -7,323 +12,456 @@
 // number conversion warnings
 #pragma warning(disable : 4244)
 
-const char* textVertexShaderSource = R"(
-    #version 330 core
-
-    layout (location = 0) in vec4 vertex;
-    out vec2 TexCoords;
-    
-    uniform mat4 projection;
-    
-    void main() {
-        gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
-        TexCoords = vertex.zw;
-    }
-)";
-
-const char* textFragmentShaderSource = R"(
-    #version 330 core
-
-    in vec2 TexCoords;
-    out vec4 color;
-    
-    uniform sampler2D text;
-    uniform vec4 textColor;
-    
-    void main() {
-        vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-        color = textColor * sampled;
-    }
-)";
-
-const char* vertexShaderSource = R"(
-    #version 330 core
-
-    layout (location = 0) in vec2 aPos;
-    layout (location = 1) in vec4 aColor;
-    
-    uniform mat4 projection;
-    
-    out vec4 fragColor;
-    
-    void main() {
-        gl_Position = projection * vec4(aPos.x, aPos.y, 0.0, 1.0);
-        fragColor = aColor;
-    }
-)";
-
-const char* fragmentShaderSource = R"(
-    #version 330 core
-
-    in vec4 fragColor;
-    out vec4 FragColor;
-    
-    void main() {
-        FragColor = fragColor;
-    }
-)";
-
-const char* imageVertexShaderSource = R"(
-	#version 330 core
-
-	layout (location = 0) in vec2 aPos;
-	layout (location = 1) in vec2 aTexCoords;
-
-	out vec2 TexCoords;
-
-    uniform mat4 projection;
-    uniform mat4 model;
-
-	void main() {
-		gl_Position = projection * model * vec4(aPos.x, aPos.y, 0.0, 1.0);
-		TexCoords = aTexCoords;
-	}
-)";
-
-const char* imageFragmentShaderSource = R"(
-	#version 330 core
-
-    in vec2 TexCoords;
-    out vec4 color;
-
-    uniform sampler2D image;
-    uniform float alpha;
-    uniform vec3 blendColor;
-
-    void main() {
-        vec4 texColor = texture(image, TexCoords);
-        float threshold = 1;
-        // Check if the pixel is close to white
-        if (length(texColor.rgb - vec3(1.0, 1.0, 1.0)) < threshold) {
-            color = vec4(blendColor, texColor.a * alpha);
-        } else {
-            color = vec4(texColor.rgb, texColor.a * alpha);
+TextureAtlas::TextureAtlas(RenderBackend& backend) : backend(backend) {
+}
+
+TextureAtlas::~TextureAtlas() {
+    for (const Page& page : pages) {
+        backend.deleteTexture(page.texture);
+    }
+    for (GLuint texture : standaloneTextures) {
+        backend.deleteTexture(texture);
+    }
+}
+
+TextureRegion TextureAtlas::add(const unsigned char* pixels, int width, int height, int channels) {
+    int paddedWidth = width + 2 * PADDING;
+    int paddedHeight = height + 2 * PADDING;
+
+    // Expand to RGBA with the edge pixels repeated into the padding
+    std::vector<unsigned char> rgba(paddedWidth * paddedHeight * 4);
+    for (int py = 0; py < paddedHeight; ++py) {
+        int sy = std::min(std::max(py - PADDING, 0), height - 1);
+        for (int px = 0; px < paddedWidth; ++px) {
+            int sx = std::min(std::max(px - PADDING, 0), width - 1);
+            const unsigned char* src = pixels + (sy * width + sx) * channels;
+            unsigned char* dst = &rgba[(py * paddedWidth + px) * 4];
+            if (channels < 3) {
+                dst[0] = dst[1] = dst[2] = src[0];
+                dst[3] = channels == 2 ? src[1] : 255;
+            }
+            else {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = channels == 4 ? src[3] : 255;
+            }
         }
     }
-)";
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
-    GLuint vertex, fragment;
+    TextureRegion region;
+    region.width = width;
+    region.height = height;
 
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vertexPath, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    if (paddedWidth > PAGE_SIZE || paddedHeight > PAGE_SIZE) {
+        GLuint texture = backend.createTexture();
+        standaloneTextures.push_back(texture);
 
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fragmentPath, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+        // Full mip chain, there are no neighbours to bleed into
+        std::vector<unsigned char> unpadded(width * height * 4);
+        for (int y = 0; y < height; ++y) {
+            memcpy(&unpadded[y * width * 4], &rgba[((y + PADDING) * paddedWidth + PADDING) * 4], width * 4);
+        }
+        TextureDesc desc = { TextureFormat::RGBA, width, height, 1, getMipLevelCount(width, height) - 1, false };
+        const unsigned char* level = unpadded.data();
+        backend.uploadTexture(texture, desc, &level);
+
+        region.texture = texture;
+        return region;
+    }
+
+    // First page with room, a new one otherwise
+    size_t pageIndex = 0;
+    int x = 0, y = 0;
+    size_t node = 0;
+    while (pageIndex < pages.size() && !findPosition(pages[pageIndex], paddedWidth, paddedHeight, x, y, node)) {
+        pageIndex++;
+    }
+    if (pageIndex == pages.size()) {
+        Page page;
+        page.texture = backend.createTexture();
+        page.pixels.assign(PAGE_SIZE * PAGE_SIZE * 4, 0);
+        page.skyline.push_back({ 0, 0, PAGE_SIZE });
+        page.dirty = true;
+        pages.push_back(page);
+        findPosition(pages.back(), paddedWidth, paddedHeight, x, y, node);
+    }
 
-    this->Program = glCreateProgram();
-    glAttachShader(this->Program, vertex);
-    glAttachShader(this->Program, fragment);
-    glLinkProgram(this->Program);
-    checkCompileErrors(this->Program, "PROGRAM");
+    Page& page = pages[pageIndex];
+    placeRect(page, node, x, y, paddedWidth, paddedHeight);
+    for (int row = 0; row < paddedHeight; ++row) {
+        memcpy(&page.pixels[((y + row) * PAGE_SIZE + x) * 4], &rgba[row * paddedWidth * 4], paddedWidth * 4);
+    }
+    page.dirty = true;
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    region.texture = page.texture;
+    region.uvMin = glm::vec2(x + PADDING, y + PADDING) / static_cast<float>(PAGE_SIZE);
+    region.uvMax = glm::vec2(x + PADDING + width, y + PADDING + height) / static_cast<float>(PAGE_SIZE);
+    return region;
 }
 
-void Shader::Use() {
-    glUseProgram(this->Program);
+TextureRegion TextureAtlas::addMipmapped(const unsigned char* const* levels, int levelCount, int width, int height) {
+    // Page mips are generated for the whole page, only the base level is packed
+    if (width + 2 * PADDING <= PAGE_SIZE && height + 2 * PADDING <= PAGE_SIZE) {
+        return add(levels[0], width, height, 4);
+    }
+
+    GLuint texture = backend.createTexture();
+    standaloneTextures.push_back(texture);
+
+    TextureDesc desc = { TextureFormat::RGBA, width, height, levelCount, levelCount - 1, false };
+    backend.uploadTexture(texture, desc, levels);
+
+    TextureRegion region(texture);
+    region.width = width;
+    region.height = height;
+    return region;
 }
 
-void Shader::checkCompileErrors(GLuint shader, std::string type) {
-    GLint success;
-    GLchar infoLog[1024];
-    if (type != "PROGRAM") {
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
-            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << std::endl;
+void TextureAtlas::upload() {
+    for (Page& page : pages) {
+        if (page.dirty) {
+            TextureDesc desc = { TextureFormat::RGBA, PAGE_SIZE, PAGE_SIZE, 1, MAX_MIP_LEVEL, false };
+            const unsigned char* level = page.pixels.data();
+            backend.uploadTexture(page.texture, desc, &level);
+            page.dirty = false;
         }
     }
-    else {
-        glGetProgramiv(shader, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(shader, sizeof(infoLog), NULL, infoLog);
-            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << std::endl;
+}
+
+bool TextureAtlas::findPosition(const Page& page, int width, int height, int& x, int& y, size_t& node) const {
+    // Bottom-left rule: lowest top edge wins, ties go to the narrower skyline segment
+    int bestTop = PAGE_SIZE + 1;
+    int bestWidth = PAGE_SIZE + 1;
+    bool found = false;
+
+    for (size_t i = 0; i < page.skyline.size(); ++i) {
+        int left = page.skyline[i].x;
+        if (left + width > PAGE_SIZE) {
+            break;
+        }
+
+        // The rectangle rests on the highest segment it spans
+        int top = 0;
+        int remaining = width;
+        for (size_t j = i; remaining > 0; ++j) {
+            top = std::max(top, page.skyline[j].y);
+            remaining -= page.skyline[j].width;
+        }
+
+        if (top + height > PAGE_SIZE) {
+            continue;
+        }
+        if (top + height < bestTop || (top + height == bestTop && page.skyline[i].width < bestWidth)) {
+            bestTop = top + height;
+            bestWidth = page.skyline[i].width;
+            x = left;
+            y = top;
+            node = i;
+            found = true;
         }
     }
+
+    return found;
 }
 
-Renderer::Renderer(int width, int height) : width(width), height(height) {
-    shader = new Shader(vertexShaderSource, fragmentShaderSource);
-    textShader = new Shader(textVertexShaderSource, textFragmentShaderSource);
-	imageShader = new Shader(imageVertexShaderSource, imageFragmentShaderSource);
+void TextureAtlas::placeRect(Page& page, size_t node, int x, int y, int width, int height) {
+    std::vector<SkylineNode>& skyline = page.skyline;
+    skyline.insert(skyline.begin() + node, { x, y + height, width });
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    // Cut the segments now covered by the new one
+    size_t i = node + 1;
+    while (i < skyline.size()) {
+        int overlap = x + width - skyline[i].x;
+        if (overlap <= 0) {
+            break;
+        }
+        if (overlap < skyline[i].width) {
+            skyline[i].x += overlap;
+            skyline[i].width -= overlap;
+            break;
+        }
+        skyline.erase(skyline.begin() + i);
+    }
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // Merge neighbours at the same height
+    for (size_t j = 0; j + 1 < skyline.size();) {
+        if (skyline[j].y == skyline[j + 1].y) {
+            skyline[j].width += skyline[j + 1].width;
+            skyline.erase(skyline.begin() + j + 1);
+        }
+        else {
+            ++j;
+        }
+    }
+}
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
+Renderer::Renderer(RenderBackend& backend, int width, int height, FontMode fontMode, const unsigned char* fontData, size_t fontSize) : backend(backend), fontMode(fontMode), width(width), height(height) {
+    capturedLayer = -1;
+    capturedSlot = -1;
+    captureMark = 0;
 
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    setProjectionMatrix(glm::ortho(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), -1.0f, 1.0f));
 
-    glBindVertexArray(0);
+    initFreeType(fontData, fontSize);
+}
 
-    projectionMatrix = glm::ortho(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), -1.0f, 1.0f);
+Renderer::~Renderer() {
+    backend.deleteTexture(glyphAtlas);
+}
 
-    initFreeType();
-	initTextRendering();
-	initRenderData();
+void Renderer::beginFrame() {
+    backend.beginFrame();
+}
+
+void Renderer::setViewport(int width, int height) {
+    this->width = width;
+    this->height = height;
+    backend.setViewport(width, height);
+}
+
+void Renderer::setClearColor(const glm::vec4& color) {
+    backend.setClearColor(color);
 }
 
 void Renderer::setProjectionMatrix(const glm::mat4& matrix) {
     projectionMatrix = matrix;
+    backend.setProjectionMatrix(projectionMatrix);
 }
 
-void Renderer::drawRectangle(float x, float y, float width, float height, const float color[4]) {
-    vertices.clear();
+void Renderer::drawRecords(RenderPrimitive primitive, GLuint buffer, size_t offset, GLsizei count, GLuint texture) {
+    DrawCall call = { primitive, buffer, offset, count, texture, false };
+    if (primitive == Primitive::Text) {
+        call.texture = glyphAtlas;
+        call.distanceField = fontMode == FontMode::SignedDistanceField;
+    }
+    backend.draw(call);
+}
 
-    Vertex v1 = { x, y, color[0], color[1], color[2], color[3] };
-    Vertex v2 = { x + width, y, color[0], color[1], color[2], color[3] };
-    Vertex v3 = { x + width, y + height, color[0], color[1], color[2], color[3] };
-    Vertex v4 = { x, y + height, color[0], color[1], color[2], color[3] };
+void Renderer::drawRectangle(float x, float y, float width, float height, const float color[4]) {
+    submitRectangle(x, y, width, height, color);
+    flushRectangles();
+}
 
-    vertices = { v1, v2, v3, v4 };
+void Renderer::beginRectangles() {
+    rectangleQueue.clear();
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+void Renderer::submitRectangle(float x, float y, float width, float height, const float color[4]) {
+    ColorVertex v1 = { x, y, color[0], color[1], color[2], color[3] };
+    ColorVertex v2 = { x + width, y, color[0], color[1], color[2], color[3] };
+    ColorVertex v3 = { x + width, y + height, color[0], color[1], color[2], color[3] };
+    ColorVertex v4 = { x, y + height, color[0], color[1], color[2], color[3] };
 
-    shader->Use();
-    glBindVertexArray(VAO);
+    ColorVertex triangles[6] = { v1, v2, v3, v3, v4, v1 };
+    rectangleQueue.insert(rectangleQueue.end(), triangles, triangles + 6);
+}
 
-    GLint projLoc = glGetUniformLocation(shader->Program, "projection");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+void Renderer::flushRectangles() {
+    if (rectangleQueue.empty()) {
+        return;
+    }
+    PROFILE_SCOPE("rectangles");
 
-    glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+    size_t offset = backend.appendStream(rectangleQueue.data(), rectangleQueue.size() * sizeof(ColorVertex), sizeof(ColorVertex));
+    drawRecords(Primitive::Rectangle, backend.getStreamBuffer(), offset, static_cast<GLsizei>(rectangleQueue.size()));
 
-    glBindVertexArray(0);
+    rectangleQueue.clear();
 }
 
 void Renderer::drawCircle(float cx, float cy, float r, float* color) {
-    vertices.clear();
-
-    int segments = 360;
-    float angleStep = 2.0f * M_PI / segments;
-
-    vertices.push_back({ cx, cy, color[0], color[1], color[2], 1.0f });
-    for (int i = 0; i <= segments; ++i) {
-        float angle = M_PI / 2.0f + i * angleStep;
-        vertices.push_back({ cx + cos(angle) * r, cy + sin(angle) * r, color[0], color[1], color[2], 1.0f});
-    }
+    submitCircle(cx, cy, r, color);
+    flushCircles();
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+void Renderer::beginCircles() {
+    circleQueue.clear();
+}
 
-    shader->Use();
-    glBindVertexArray(VAO);
+void Renderer::submitCircle(float cx, float cy, float r, const float color[3]) {
+    circleQueue.push_back({ cx, cy, r, color[0], color[1], color[2], 1.0f });
+}
 
-    GLint projLoc = glGetUniformLocation(shader->Program, "projection");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+void Renderer::flushCircles() {
+    if (circleQueue.empty()) {
+        return;
+    }
+    PROFILE_SCOPE("circles");
 
-    glDrawArrays(GL_TRIANGLE_FAN, 0, segments + 2);
+    size_t offset = backend.appendStream(circleQueue.data(), circleQueue.size() * sizeof(CircleInstance), sizeof(CircleInstance));
+    drawRecords(Primitive::Circle, backend.getStreamBuffer(), offset, static_cast<GLsizei>(circleQueue.size()));
 
-    glBindVertexArray(0);
+    circleQueue.clear();
 }
 
 void Renderer::drawParkingSpotTimer(float cx, float cy, float r, float redProgress) {
-    vertices.clear();
+    submitParkingSpotTimer(cx, cy, r, redProgress);
+    flushParkingSpotTimers();
+}
 
-    int segments = 1000;
-    float angleStep = 2.0f * M_PI / segments;
+void Renderer::beginParkingSpotTimers() {
+    timerQueue.clear();
+}
 
-	// Draw the green part of the timer
-    vertices.push_back({ cx, cy, 0.0f, 1.0f, 0.0f, 1.0f });
-    for (int i = 0; i <= segments * (1.0f - redProgress); ++i) {
-        float angle = M_PI / 2.0f + i * angleStep;
-        vertices.push_back({ cx + cos(angle) * r, cy + sin(angle) * r, 0.0f, 1.0f, 0.0f, 1.0f });
-    }
+void Renderer::submitParkingSpotTimer(float cx, float cy, float r, float redProgress) {
+    timerQueue.push_back({ cx, cy, r, redProgress });
+}
 
-	// Draw the red part of the timer
-    vertices.push_back({ cx, cy, 1.0f, 0.0f, 0.0f, 1.0f });
-    for (int i = segments * (1.0f - redProgress); i <= segments; ++i) {
-        float angle = M_PI / 2.0f + i * angleStep;
-        vertices.push_back({ cx + cos(angle) * r, cy + sin(angle) * r, 1.0f, 0.0f, 0.0f, 1.0f });
+void Renderer::flushParkingSpotTimers() {
+    if (timerQueue.empty()) {
+        return;
     }
+    PROFILE_SCOPE("timers");
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    size_t offset = backend.appendStream(timerQueue.data(), timerQueue.size() * sizeof(TimerInstance), sizeof(TimerInstance));
+    drawRecords(Primitive::Timer, backend.getStreamBuffer(), offset, static_cast<GLsizei>(timerQueue.size()));
 
-    shader->Use();
-    glBindVertexArray(VAO);
+    timerQueue.clear();
+}
 
-    GLint projLoc = glGetUniformLocation(shader->Program, "projection");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+void Renderer::drawText(const std::string& text, float x, float y, float scale, glm::vec4 color) {
+    submitText(text, x, y, scale, color);
+    flushText();
+}
 
-    glDrawArrays(GL_TRIANGLE_FAN, 0, segments * (1.0f - redProgress) + 2);
-    glDrawArrays(GL_TRIANGLE_FAN, segments * (1.0f - redProgress) + 2, segments - segments * (1.0f - redProgress) + 2);
+void Renderer::beginText() {
+    textQueue.clear();
+}
 
-    glBindVertexArray(0);
+void Renderer::submitText(const std::string& text, float x, float y, float scale, glm::vec4 color) {
+    appendGlyphQuads(textQueue, text, x, y, scale, color);
 }
 
-void Renderer::drawText(const std::string& text, float x, float y, float scale, glm::vec4 color) {    
-    textShader->Use();
-    glUniform4f(glGetUniformLocation(textShader->Program, "textColor"), color.x, color.y, color.z, color.w);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(textVAO);
+// Updates the layout only if the text or scale differ from the ones it was built for
+void Renderer::layoutText(TextLayout& layout, const std::string& text, float scale) {
+    if (layout.valid && layout.scale == scale && layout.text == text) {
+        return;
+    }
+    PROFILE_SCOPE("text layout");
+
+    layout.text = text;
+    layout.scale = scale;
+    layout.quads.clear();
+    appendGlyphQuads(layout.quads, text, 0.0f, 0.0f, scale, glm::vec4(1.0f));
+    layout.width = measureTextWidth(text, scale);
+    layout.valid = true;
+}
 
-    GLint projLoc = glGetUniformLocation(textShader->Program, "projection");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+void Renderer::submitText(const TextLayout& layout, float x, float y, glm::vec4 color) {
+    size_t first = textQueue.size();
+    textQueue.insert(textQueue.end(), layout.quads.begin(), layout.quads.end());
+    for (size_t i = first; i < textQueue.size(); ++i) {
+        TextVertex& vertex = textQueue[i];
+        vertex.x += x;
+        vertex.y += y;
+        vertex.r = color.r;
+        vertex.g = color.g;
+        vertex.b = color.b;
+        vertex.a = color.a;
+    }
+}
 
+const Renderer::Character& Renderer::getCharacter(char c) const {
+    static const Character empty = {};
+    unsigned char code = static_cast<unsigned char>(c);
+    return code < GLYPH_COUNT ? Characters[code] : empty;
+}
+
+void Renderer::appendGlyphQuads(std::vector<TextVertex>& quads, const std::string& text, float x, float y, float scale, glm::vec4 color) const {
     std::string::const_iterator c;
     for (c = text.begin(); c != text.end(); c++) {
-        Character ch = Characters[*c];
+        const Character& ch = getCharacter(*c);
 
         float xpos = x + ch.Bearing.x * scale;
         float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
 
         float w = ch.Size.x * scale;
         float h = ch.Size.y * scale;
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }
+        TextVertex quad[6] = {
+            { xpos,     ypos + h,   ch.UVMin.x, ch.UVMin.y, color.r, color.g, color.b, color.a },
+            { xpos,     ypos,       ch.UVMin.x, ch.UVMax.y, color.r, color.g, color.b, color.a },
+            { xpos + w, ypos,       ch.UVMax.x, ch.UVMax.y, color.r, color.g, color.b, color.a },
+
+            { xpos,     ypos + h,   ch.UVMin.x, ch.UVMin.y, color.r, color.g, color.b, color.a },
+            { xpos + w, ypos,       ch.UVMax.x, ch.UVMax.y, color.r, color.g, color.b, color.a },
+            { xpos + w, ypos + h,   ch.UVMax.x, ch.UVMin.y, color.r, color.g, color.b, color.a }
         };
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        x += (ch.Advance >> 6) * scale;
+        quads.insert(quads.end(), quad, quad + 6);
+        x += ch.Advance * scale;
+    }
+}
+
+void Renderer::flushText() {
+    if (textQueue.empty()) {
+        return;
     }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    PROFILE_SCOPE("text");
+
+    size_t offset = backend.appendStream(textQueue.data(), textQueue.size() * sizeof(TextVertex), sizeof(TextVertex));
+    drawRecords(Primitive::Text, backend.getStreamBuffer(), offset, static_cast<GLsizei>(textQueue.size()));
+
+    textQueue.clear();
 }
 
 float Renderer::measureTextWidth(const std::string& text, float scale) {
     float width = 0.0f;
     std::string::const_iterator c;
     for (c = text.begin(); c != text.end(); c++) {
-        Character ch = Characters[*c];
-        width += (ch.Advance >> 6) * scale;
+        width += getCharacter(*c).Advance * scale;
     }
     return width;
 }
 
-void Renderer::initTextRendering() {
-    glGenVertexArrays(1, &textVAO);
-    glGenBuffers(1, &textVBO);
-    glBindVertexArray(textVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+// Signed distance field of a coverage bitmap, padded by the spread on every side.
+// 0.5 (128) is the outline, 0 and 1 are the spread outside and inside of it.
+std::vector<unsigned char> Renderer::generateDistanceField(const std::vector<unsigned char>& coverage, int width, int rows, int spread) {
+    int fieldWidth = width + 2 * spread;
+    int fieldRows = rows + 2 * spread;
+
+    auto coverageAt = [&](int x, int y) -> float {
+        x -= spread;
+        y -= spread;
+        if (x < 0 || y < 0 || x >= width || y >= rows) {
+            return 0.0f;
+        }
+        return coverage[y * width + x] / 255.0f;
+    };
+
+    std::vector<unsigned char> field(static_cast<size_t>(fieldWidth) * fieldRows);
+    for (int y = 0; y < fieldRows; ++y) {
+        for (int x = 0; x < fieldWidth; ++x) {
+            float own = coverageAt(x, y);
+            bool inside = own >= 0.5f;
+
+            float distance;
+            if (own > 0.0f && own < 1.0f) {
+                // Anti-aliased edge pixel, its coverage places the outline inside it
+                distance = std::abs(own - 0.5f);
+            }
+            else {
+                // Nearest pixel on the other side of the outline within the spread
+                float nearest = static_cast<float>(spread);
+                for (int dy = -spread; dy <= spread; ++dy) {
+                    for (int dx = -spread; dx <= spread; ++dx) {
+                        if ((coverageAt(x + dx, y + dy) >= 0.5f) != inside) {
+                            nearest = std::min(nearest, std::sqrt(static_cast<float>(dx * dx + dy * dy)) - 0.5f);
+                        }
+                    }
+                }
+                distance = nearest;
+            }
+
+            float signedDistance = inside ? distance : -distance;
+            float value = 0.5f + 0.5f * signedDistance / spread;
+            field[y * fieldWidth + x] = static_cast<unsigned char>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+    return field;
 }
 
-void Renderer::initFreeType() {
+void Renderer::initFreeType(const unsigned char* fontData, size_t fontSize) {
+    std::fill(Characters, Characters + GLYPH_COUNT, Character());
+
     FT_Library ft;
     if (FT_Init_FreeType(&ft)) {
         std::cerr << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
@@ -331,132 +469,469 @@ void Renderer::initFreeType() {
     }
 
     FT_Face face;
-    if (FT_New_Face(ft, "Gill_Sans.otf", 0, &face)) {
+    FT_Error error = fontData ? FT_New_Memory_Face(ft, fontData, static_cast<FT_Long>(fontSize), 0, &face) : FT_New_Face(ft, "Gill_Sans.otf", 0, &face);
+    if (error) {
         std::cerr << "ERROR::FREETYPE: Failed to load font" << std::endl;
         return;
     }
 
-    FT_Set_Pixel_Sizes(face, 0, 48);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // Distance fields are built from a smaller raster, the shader keeps them sharp when scaled up
+    const bool distanceField = fontMode == FontMode::SignedDistanceField;
+    const int pixelSize = distanceField ? SDF_PIXEL_SIZE : TEXT_REFERENCE_SIZE;
+    const int spread = distanceField ? SDF_SPREAD : 0;
+    const float metricScale = static_cast<float>(TEXT_REFERENCE_SIZE) / pixelSize;
+
+    FT_Set_Pixel_Sizes(face, 0, pixelSize);
+
+    // Rasterize every glyph first so the atlas can be sized to fit them all
+    struct GlyphBitmap {
+        GLubyte c;
+        int width, rows;
+        std::vector<unsigned char> pixels;
+        Character character;
+    };
 
-    for (GLubyte c = 0; c < 128; c++) {
+    std::vector<GlyphBitmap> glyphs;
+    for (GLubyte c = 0; c < GLYPH_COUNT; c++) {
         if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
             std::cerr << "ERROR::FREETYPE: Failed to load Glyph" << std::endl;
             continue;
         }
-        GLuint texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer
-        );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-            glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            face->glyph->advance.x
+        FT_Bitmap& bitmap = face->glyph->bitmap;
+
+        GlyphBitmap glyph;
+        glyph.c = c;
+        glyph.width = bitmap.width;
+        glyph.rows = bitmap.rows;
+        glyph.pixels.resize(static_cast<size_t>(bitmap.width) * bitmap.rows);
+        for (unsigned int row = 0; row < bitmap.rows; ++row) {
+            std::copy(bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + bitmap.width, glyph.pixels.begin() + row * bitmap.width);
+        }
+
+        // The distance field extends the bitmap by the spread on every side
+        if (distanceField && glyph.width > 0 && glyph.rows > 0) {
+            glyph.pixels = generateDistanceField(glyph.pixels, glyph.width, glyph.rows, spread);
+            glyph.width += 2 * spread;
+            glyph.rows += 2 * spread;
+        }
+        int border = glyph.width > 0 ? spread : 0;
+
+        glyph.character = {
+            glm::vec2(0.0f),
+            glm::vec2(0.0f),
+            glm::vec2(glyph.width, glyph.rows) * metricScale,
+            glm::vec2(face->glyph->bitmap_left - border, face->glyph->bitmap_top + border) * metricScale,
+            (face->glyph->advance.x >> 6) * metricScale
         };
-        Characters.insert(std::pair<GLchar, Character>(c, character));
+        glyphs.push_back(glyph);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Shelf packing: glyphs are placed left to right, a new shelf starts when the row is full
+    const int atlasWidth = 512;
+    const int padding = 1;
+    std::vector<glm::ivec2> positions(glyphs.size());
+    int penX = padding, penY = padding, shelfHeight = 0;
+    for (size_t i = 0; i < glyphs.size(); ++i) {
+        if (penX + glyphs[i].width + padding > atlasWidth) {
+            penX = padding;
+            penY += shelfHeight + padding;
+            shelfHeight = 0;
+        }
+        positions[i] = glm::ivec2(penX, penY);
+        penX += glyphs[i].width + padding;
+        shelfHeight = std::max(shelfHeight, glyphs[i].rows);
+    }
+
+    int atlasHeight = 1;
+    while (atlasHeight < penY + shelfHeight + padding) {
+        atlasHeight *= 2;
+    }
+    glyphAtlasSize = glm::ivec2(atlasWidth, atlasHeight);
+
+    std::vector<unsigned char> atlasPixels(static_cast<size_t>(atlasWidth) * atlasHeight, 0);
+    for (size_t i = 0; i < glyphs.size(); ++i) {
+        GlyphBitmap& glyph = glyphs[i];
+        for (int row = 0; row < glyph.rows; ++row) {
+            std::copy(glyph.pixels.begin() + row * glyph.width, glyph.pixels.begin() + (row + 1) * glyph.width,
+                atlasPixels.begin() + (positions[i].y + row) * atlasWidth + positions[i].x);
+        }
+        glyph.character.UVMin = glm::vec2(positions[i]) / glm::vec2(glyphAtlasSize);
+        glyph.character.UVMax = glm::vec2(positions[i] + glm::ivec2(glyph.width, glyph.rows)) / glm::vec2(glyphAtlasSize);
+        Characters[glyph.c] = glyph.character;
+    }
+
+    TextureDesc desc = { TextureFormat::Red, atlasWidth, atlasHeight, 1, 0, false };
+    const unsigned char* level = atlasPixels.data();
+    glyphAtlas = backend.createTexture();
+    backend.uploadTexture(glyphAtlas, desc, &level);
 
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
 }
 
-void Renderer::renderImage(GLuint textureID, float x, float y, float width, float height, float rotation = 0.0f, float alpha = 1.0f, glm::vec3 blendColor = {1.0f, 1.0f, 1.0f}) {
-    imageShader->Use();
+void Renderer::renderImage(const TextureRegion& region, float x, float y, float width, float height, float rotation = 0.0f, float alpha = 1.0f, glm::vec3 blendColor = {1.0f, 1.0f, 1.0f}) {
+    // Immediate draw, also flushes anything already queued so the order is preserved
+    submitSprite(region, x, y, width, height, rotation, alpha, blendColor);
+    flushSprites();
+}
 
-    // Set the projection matrix
-    GLint projLoc = glGetUniformLocation(imageShader->Program, "projection");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+void Renderer::beginSprites() {
+    spriteQueue.clear();
+}
 
-    // Set the alpha value
-    GLint alphaLoc = glGetUniformLocation(imageShader->Program, "alpha");
-    glUniform1f(alphaLoc, alpha);
+void Renderer::submitSprite(const TextureRegion& region, float x, float y, float width, float height, float rotation, float alpha, glm::vec3 blendColor) {
+    QueuedSprite sprite = {
+        region.texture,
+        { x, y, width, height, region.uvMin.x, region.uvMin.y, region.uvMax.x, region.uvMax.y, rotation, alpha, blendColor.r, blendColor.g, blendColor.b }
+    };
+    spriteQueue.push_back(sprite);
+}
 
-    // Set the blend color
-    GLint blendColorLoc = glGetUniformLocation(imageShader->Program, "blendColor");
-    glUniform3fv(blendColorLoc, 1, glm::value_ptr(blendColor));
+void Renderer::flushSprites() {
+    if (spriteQueue.empty()) {
+        return;
+    }
+    PROFILE_SCOPE("sprites");
+
+    // Group the sprites by texture, keeping the textures in the order of first submission
+    spriteTextures.clear();
+    spriteTextureCounts.clear();
+    std::vector<size_t> groupOfSprite(spriteQueue.size());
+    for (size_t i = 0; i < spriteQueue.size(); ++i) {
+        size_t group = 0;
+        while (group < spriteTextures.size() && spriteTextures[group] != spriteQueue[i].texture) {
+            ++group;
+        }
+        if (group == spriteTextures.size()) {
+            spriteTextures.push_back(spriteQueue[i].texture);
+            spriteTextureCounts.push_back(0);
+        }
+        spriteTextureCounts[group]++;
+        groupOfSprite[i] = group;
+    }
 
-    // Create transformation matrix
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(x + width / 2, y + height / 2, 0.0f)); // Move to the center of the quad
-    model = glm::rotate(model, glm::radians(rotation), glm::vec3(0.0f, 0.0f, 1.0f)); // Rotate around the center
-    model = glm::translate(model, glm::vec3(-width / 2, -height / 2, 0.0f)); // Move back to the original position
-    model = glm::scale(model, glm::vec3(width, height, 1.0f)); // Scale to the desired size
+    std::vector<size_t> groupOffsets(spriteTextures.size(), 0);
+    for (size_t group = 1; group < spriteTextures.size(); ++group) {
+        groupOffsets[group] = groupOffsets[group - 1] + spriteTextureCounts[group - 1];
+    }
 
-    GLint modelLoc = glGetUniformLocation(imageShader->Program, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    spriteUpload.resize(spriteQueue.size());
+    std::vector<size_t> writePositions = groupOffsets;
+    for (size_t i = 0; i < spriteQueue.size(); ++i) {
+        spriteUpload[writePositions[groupOfSprite[i]]++] = spriteQueue[i].instance;
+    }
 
-    // Bind the texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    // Stream all instances with one upload
+    size_t offset = backend.appendStream(spriteUpload.data(), spriteUpload.size() * sizeof(SpriteInstance), sizeof(SpriteInstance));
 
-    // Set up the vertices and texture coordinates
-    float vertices[] = {
-        // Positions          // Texture Coords
-        0.0f, 0.0f,           0.0f, 0.0f,
-        1.0f, 0.0f,           1.0f, 0.0f,
-        1.0f, 1.0f,           1.0f, 1.0f,
-        0.0f, 1.0f,           0.0f, 1.0f
-    };
+    // One instanced draw per texture
+    for (size_t group = 0; group < spriteTextures.size(); ++group) {
+        drawRecords(Primitive::Sprite, backend.getStreamBuffer(), offset + groupOffsets[group] * sizeof(SpriteInstance), static_cast<GLsizei>(spriteTextureCounts[group]), spriteTextures[group]);
+    }
 
-    unsigned int indices[] = {
-        0, 1, 2,
-        2, 3, 0
-    };
+    spriteQueue.clear();
+}
 
-    // Bind and set vertex buffer(s) and attribute pointer(s)
-    glBindVertexArray(imageVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, imageVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+// Draws take the record count as a GLsizei
+static const size_t MAX_LAYER_RECORDS = INT_MAX;
+static const size_t MIN_LAYER_CAPACITY = 256;
+// Holes of at least this many vertices are skipped by starting a new draw
+static const size_t SKIPPED_HOLE_VERTICES = 1024;
+// A layer is repacked once its holes make up a quarter of the records in use
+static const size_t MIN_COMPACTED_HOLES = 64;
+// Dirty ranges this close are uploaded with one update, rewriting the records between them
+static const size_t MERGED_UPLOAD_GAP = 64;
+
+static size_t getRecordSize(RenderPrimitive primitive) {
+    switch (primitive) {
+    case RenderPrimitive::Rectangle: return sizeof(ColorVertex);
+    case RenderPrimitive::Circle: return sizeof(CircleInstance);
+    case RenderPrimitive::Timer: return sizeof(TimerInstance);
+    case RenderPrimitive::Sprite: return sizeof(SpriteInstance);
+    case RenderPrimitive::Text: return sizeof(TextVertex);
+    default: return 0;
+    }
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, imageEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+// Vertices the backend runs per record, a degenerate circle still costs the whole fan
+static size_t getRecordVertices(RenderPrimitive primitive) {
+    switch (primitive) {
+    case RenderPrimitive::Circle: return CIRCLE_SEGMENTS + 2;
+    case RenderPrimitive::Timer:
+    case RenderPrimitive::Sprite: return 6;
+    default: return 1;
+    }
+}
 
-    // Set the vertex attribute pointers
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+int Renderer::createLayer(Primitive primitive, int slotCount, GLuint texture) {
+    RetainedLayer layer;
+    layer.primitive = primitive;
+    layer.texture = texture;
+    layer.recordSize = getRecordSize(primitive);
+    layer.capacity = MIN_LAYER_CAPACITY;
+    layer.used = 0;
+    layer.records.assign(layer.capacity * layer.recordSize, 0);
+    layer.ranges.assign(slotCount, LayerRange{ 0, 0 });
+    layer.owners.assign(layer.capacity, -1);
+    layer.holeRecords = 0;
+    layer.reallocated = false;
+
+    // Starts out with every slot empty
+    layer.buffer = backend.createBuffer(layer.capacity * layer.recordSize);
+
+    layers.push_back(layer);
+    return static_cast<int>(layers.size()) - 1;
+}
 
-    // Draw the textured quad
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+size_t Renderer::queueSize(Primitive primitive) const {
+    switch (primitive) {
+    case Primitive::Rectangle: return rectangleQueue.size();
+    case Primitive::Circle: return circleQueue.size();
+    case Primitive::Timer: return timerQueue.size();
+    case Primitive::Sprite: return spriteQueue.size();
+    case Primitive::Text: return textQueue.size();
+    }
+    return 0;
+}
+
+void Renderer::beginLayerSlot(int layer, int slot) {
+    capturedLayer = layer;
+    capturedSlot = slot;
+    captureMark = queueSize(layers[layer].primitive);
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindVertexArray(0);
+// Moves the records queued after the mark into the slot
+template <typename Record>
+static void takeQueuedRecords(std::vector<Record>& queue, size_t mark, std::vector<unsigned char>& slotData) {
+    size_t count = queue.size() - mark;
+    slotData.resize(count * sizeof(Record));
+    memcpy(slotData.data(), queue.data() + mark, count * sizeof(Record));
+    queue.resize(mark);
 }
 
-void Renderer::initRenderData() {
-    // Generate and bind the VAO, VBO, and EBO
-    glGenVertexArrays(1, &imageVAO);
-    glGenBuffers(1, &imageVBO);
-    glGenBuffers(1, &imageEBO);
+void Renderer::endLayerSlot() {
+    RetainedLayer& layer = layers[capturedLayer];
+
+    switch (layer.primitive) {
+    case Primitive::Rectangle: takeQueuedRecords(rectangleQueue, captureMark, slotData); break;
+    case Primitive::Circle: takeQueuedRecords(circleQueue, captureMark, slotData); break;
+    case Primitive::Timer: takeQueuedRecords(timerQueue, captureMark, slotData); break;
+    case Primitive::Text: takeQueuedRecords(textQueue, captureMark, slotData); break;
+    case Primitive::Sprite: {
+        // The layer's texture is used for every sprite
+        size_t count = spriteQueue.size() - captureMark;
+        slotData.resize(count * sizeof(SpriteInstance));
+        for (size_t i = 0; i < count; ++i) {
+            memcpy(slotData.data() + i * sizeof(SpriteInstance), &spriteQueue[captureMark + i].instance, sizeof(SpriteInstance));
+        }
+        spriteQueue.resize(captureMark);
+        break;
+    }
+    }
 
-    glBindVertexArray(imageVAO);
+    writeLayerSlot(layer, capturedSlot, slotData.data(), slotData.size() / layer.recordSize);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, imageVBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, imageEBO);
+void Renderer::writeLayerSlot(RetainedLayer& layer, int slot, const unsigned char* data, size_t count) {
+    LayerRange& range = layer.ranges[slot];
 
-    // Set the vertex attribute pointers
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // A slot that grows moves to the end, one that shrinks gives up its tail
+    if (count > range.count) {
+        if (layer.used + count > MAX_LAYER_RECORDS) {
+            std::cerr << "ERROR::RENDERER: Layer full, the " << count << " records of slot " << slot << " are dropped" << std::endl;
+            count = 0;
+        }
+        else {
+            freeLayerRecords(layer, range.first, range.count);
+            range.first = allocateLayerRecords(layer, count);
+            range.count = count;
+            layer.owners[range.first] = slot;
+        }
+    }
+    if (count < range.count) {
+        freeLayerRecords(layer, range.first + count, range.count - count);
+        range.count = count;
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-}
\ No newline at end of file
+    if (count > 0) {
+        memcpy(layer.records.data() + range.first * layer.recordSize, data, count * layer.recordSize);
+        layer.dirtyRanges.push_back(range);
+    }
+
+    if (layer.holeRecords >= MIN_COMPACTED_HOLES && layer.holeRecords * 4 >= layer.used) {
+        compactLayer(layer);
+    }
+}
+
+size_t Renderer::allocateLayerRecords(RetainedLayer& layer, size_t count) {
+    size_t first = layer.used;
+    layer.used += count;
+    if (layer.used <= layer.capacity) {
+        return first;
+    }
+
+    // The records are kept on the CPU, a bigger buffer is filled from them on the next draw
+    layer.capacity = std::max(layer.used, layer.capacity * 2);
+    layer.records.resize(layer.capacity * layer.recordSize, 0);
+    layer.owners.resize(layer.capacity, -1);
+    backend.deleteBuffer(layer.buffer);
+    layer.buffer = backend.createBuffer(layer.capacity * layer.recordSize);
+    layer.reallocated = true;
+    return first;
+}
+
+void Renderer::freeLayerRecords(RetainedLayer& layer, size_t first, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    layer.owners[first] = -1;
+
+    // Records at the end are simply given back, along with a hole in front of them
+    if (first + count == layer.used) {
+        layer.used = first;
+        if (!layer.holes.empty()) {
+            std::map<size_t, size_t>::iterator last = std::prev(layer.holes.end());
+            if (last->first + last->second == layer.used) {
+                layer.used = last->first;
+                removeLayerHole(layer, last);
+            }
+        }
+        return;
+    }
+
+    memset(layer.records.data() + first * layer.recordSize, 0, count * layer.recordSize);
+    layer.dirtyRanges.push_back(LayerRange{ first, count });
+
+    // Merged with the holes on either side
+    std::map<size_t, size_t>::iterator next = layer.holes.lower_bound(first);
+    if (next != layer.holes.begin()) {
+        std::map<size_t, size_t>::iterator previous = std::prev(next);
+        if (previous->first + previous->second == first) {
+            first = previous->first;
+            count += previous->second;
+            removeLayerHole(layer, previous);
+        }
+    }
+    if (next != layer.holes.end() && next->first == first + count) {
+        count += next->second;
+        removeLayerHole(layer, next);
+    }
+    addLayerHole(layer, first, count);
+}
+
+void Renderer::addLayerHole(RetainedLayer& layer, size_t first, size_t count) {
+    layer.holes[first] = count;
+    layer.holeRecords += count;
+    if (count * getRecordVertices(layer.primitive) >= SKIPPED_HOLE_VERTICES) {
+        layer.skippedHoles.insert(first);
+    }
+}
+
+void Renderer::removeLayerHole(RetainedLayer& layer, std::map<size_t, size_t>::iterator hole) {
+    layer.holeRecords -= hole->second;
+    layer.skippedHoles.erase(hole->first);
+    layer.holes.erase(hole);
+}
+
+// Packs the ranges in their current order, walking the records in use rather than every slot
+void Renderer::compactLayer(RetainedLayer& layer) {
+    PROFILE_SCOPE("compact layer");
+    size_t used = 0;
+    size_t position = 0;
+    std::map<size_t, size_t>::iterator hole = layer.holes.begin();
+    while (position < layer.used) {
+        if (hole != layer.holes.end() && hole->first == position) {
+            position += hole->second;
+            ++hole;
+            continue;
+        }
+
+        int slot = layer.owners[position];
+        LayerRange& range = layer.ranges[slot];
+        layer.owners[position] = -1;
+        memmove(layer.records.data() + used * layer.recordSize, layer.records.data() + position * layer.recordSize, range.count * layer.recordSize);
+        range.first = used;
+        layer.owners[used] = slot;
+        used += range.count;
+        position += range.count;
+    }
+
+    layer.used = used;
+    layer.holes.clear();
+    layer.skippedHoles.clear();
+    layer.holeRecords = 0;
+    layer.dirtyRanges.clear();
+    layer.dirtyRanges.push_back(LayerRange{ 0, used });
+}
+
+// One update per run of dirty ranges, runs closer than MERGED_UPLOAD_GAP are joined
+void Renderer::uploadLayer(RetainedLayer& layer) {
+    if (layer.reallocated) {
+        layer.dirtyRanges.clear();
+        layer.dirtyRanges.push_back(LayerRange{ 0, layer.used });
+        layer.reallocated = false;
+    }
+    if (layer.dirtyRanges.empty()) {
+        return;
+    }
+
+    std::sort(layer.dirtyRanges.begin(), layer.dirtyRanges.end(), [](const LayerRange& a, const LayerRange& b) {
+        return a.first < b.first;
+    });
+
+    // Records past the end were given back, they are never drawn
+    auto upload = [&](size_t first, size_t end) {
+        end = std::min(end, layer.used);
+        if (end > first) {
+            backend.updateBuffer(layer.buffer, first * layer.recordSize, layer.records.data() + first * layer.recordSize, (end - first) * layer.recordSize);
+        }
+    };
+
+    size_t first = layer.dirtyRanges[0].first;
+    size_t end = first + layer.dirtyRanges[0].count;
+    for (size_t i = 1; i < layer.dirtyRanges.size(); ++i) {
+        const LayerRange& range = layer.dirtyRanges[i];
+        if (range.first > end + MERGED_UPLOAD_GAP) {
+            upload(first, end);
+            first = range.first;
+        }
+        end = std::max(end, range.first + range.count);
+    }
+    upload(first, end);
+    layer.dirtyRanges.clear();
+}
+
+void Renderer::setLayerTexture(int index, GLuint texture) {
+    layers[index].texture = texture;
+}
+
+void Renderer::drawLayer(int index) {
+    PROFILE_SCOPE("layer");
+    RetainedLayer& layer = layers[index];
+    uploadLayer(layer);
+
+    // Small holes are drawn as degenerates, the large ones end a draw
+    size_t first = 0;
+    for (size_t holeStart : layer.skippedHoles) {
+        if (holeStart > first) {
+            drawRecords(layer.primitive, layer.buffer, first * layer.recordSize, static_cast<GLsizei>(holeStart - first), layer.texture);
+        }
+        first = holeStart + layer.holes[holeStart];
+    }
+    if (layer.used > first) {
+        drawRecords(layer.primitive, layer.buffer, first * layer.recordSize, static_cast<GLsizei>(layer.used - first), layer.texture);
+    }
+}
+
+void Renderer::beginStaticLayer(int width, int height) {
+    backend.beginOffscreen(width, height);
+}
+
+void Renderer::endStaticLayer() {
+    backend.endOffscreen();
+}
+
+void Renderer::drawStaticLayer() {
+    PROFILE_SCOPE("static layer");
+    backend.drawOffscreen();
+}
@@ -1,5 +1,7 @@
+#include <cstddef>
 #include <iostream>
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <GL/glew.h>
@@ -8,61 +10,237 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include "RenderBackend.h"
 
 #ifndef RENDERING_H
 #define RENDERING_H
 
-class Shader {
+// Part of a texture, a whole texture covers UVs 0..1
+struct TextureRegion {
+    GLuint texture;
+    glm::vec2 uvMin, uvMax;
+    int width, height;
+
+    TextureRegion(GLuint texture = 0) : texture(texture), uvMin(0.0f), uvMax(1.0f), width(0), height(0) {}
+};
+
+// Packs images into shared RGBA pages with a skyline packer, so sprites from the same page
+// draw without texture switches. Images larger than a page get a texture of their own.
+class TextureAtlas {
 public:
-    GLuint Program;
+    static const int PAGE_SIZE = 1024;
+    // Edge pixels are repeated into the padding so filtering and the first mip levels don't bleed
+    static const int PADDING = 4;
+    static const int MAX_MIP_LEVEL = 2;
+
+    TextureAtlas(RenderBackend& backend);
+    ~TextureAtlas();
 
-    Shader(const char* vertexPath, const char* fragmentPath);
-    void Use();
+    // Copies the image into a page, the region is valid right away and drawable after upload()
+    TextureRegion add(const unsigned char* pixels, int width, int height, int channels);
+    // Same for an RGBA image with its mip chain, a standalone texture gets the levels as they are
+    TextureRegion addMipmapped(const unsigned char* const* levels, int levelCount, int width, int height);
+    // Uploads the pages changed since the last call
+    void upload();
 
 private:
-    void checkCompileErrors(GLuint shader, std::string type);
+    struct SkylineNode {
+        int x, y, width;
+    };
+
+    struct Page {
+        GLuint texture;
+        std::vector<unsigned char> pixels;
+        std::vector<SkylineNode> skyline;
+        bool dirty;
+    };
+
+    RenderBackend& backend;
+    std::vector<Page> pages;
+    std::vector<GLuint> standaloneTextures;
+
+    bool findPosition(const Page& page, int width, int height, int& x, int& y, size_t& node) const;
+    void placeRect(Page& page, size_t node, int x, int y, int width, int height);
 };
 
 class Renderer {
+public:
+    // Bitmap glyphs are exact at scale 1.0, distance field glyphs stay sharp at any scale
+    enum class FontMode {
+        Bitmap,
+        SignedDistanceField
+    };
+
 private:
-    GLuint VBO, VAO;
-	GLuint textVAO, textVBO;
-    Shader* shader;
-	Shader* textShader;
-	Shader* imageShader;
+    RenderBackend& backend;
+    FontMode fontMode;
     glm::mat4 projectionMatrix;
     int width, height;
-    GLuint imageVAO, imageVBO, imageEBO;
 
-    struct Vertex {
-        float x, y;
-        float r, g, b, a;
+    std::vector<ColorVertex> rectangleQueue;
+
+    // Glyph placement, UVMin/UVMax is the glyph's rectangle inside the atlas.
+    // Size, Bearing and Advance are in pixels at the reference size of 48px, whatever size the atlas was built at.
+    struct Character {
+        glm::vec2 UVMin;
+        glm::vec2 UVMax;
+        glm::vec2 Size;
+        glm::vec2 Bearing;
+        float Advance;
     };
 
-    std::vector<Vertex> vertices;
+    // Flat glyph table indexed by the character code, codes outside it have an empty glyph
+    static const int GLYPH_COUNT = 128;
+    static const int TEXT_REFERENCE_SIZE = 48;
+    static const int SDF_PIXEL_SIZE = 32;
+    static const int SDF_SPREAD = 4;
+    Character Characters[GLYPH_COUNT];
+    GLuint glyphAtlas;
+    glm::ivec2 glyphAtlasSize;
 
-    struct Character {
-        GLuint TextureID;
-        glm::ivec2 Size;
-        glm::ivec2 Bearing;
-        GLuint Advance;
+    // Glyph quads of all queued strings
+    std::vector<TextVertex> textQueue;
+
+    const Character& getCharacter(char c) const;
+    void appendGlyphQuads(std::vector<TextVertex>& quads, const std::string& text, float x, float y, float scale, glm::vec4 color) const;
+
+    struct QueuedSprite {
+        GLuint texture;
+        SpriteInstance instance;
     };
 
-    std::map<GLchar, Character> Characters;
+    std::vector<QueuedSprite> spriteQueue;
+    std::vector<SpriteInstance> spriteUpload;
+    std::vector<GLuint> spriteTextures;
+    std::vector<size_t> spriteTextureCounts;
 
-    void initFreeType();
-	void initTextRendering();
-    void initRenderData();
+    std::vector<CircleInstance> circleQueue;
+    std::vector<TimerInstance> timerQueue;
+
+    void initFreeType(const unsigned char* fontData, size_t fontSize);
+    static std::vector<unsigned char> generateDistanceField(const std::vector<unsigned char>& coverage, int width, int rows, int spread);
+
+    // Records for every primitive go through here, text is drawn from the glyph atlas
+    void drawRecords(RenderPrimitive primitive, GLuint buffer, size_t offset, GLsizei count, GLuint texture = 0);
 
 public:
-    Renderer(int width, int height);
+    typedef RenderPrimitive Primitive;
+
+private:
+    struct LayerRange {
+        size_t first;
+        size_t count;
+    };
+
+    // Retained geometry resident on the GPU. Each slot owns a range of exactly as many records as it was
+    // last given, packed behind the others in a copy kept on the CPU. Records a slot gives up become a
+    // zeroed hole, degenerate when drawn; holes too big to be worth drawing split the draw instead.
+    struct RetainedLayer {
+        Primitive primitive;
+        GLuint texture;
+        GLuint buffer;
+        size_t recordSize;
+        // Records the buffer has room for, and the end of the last range or hole
+        size_t capacity;
+        size_t used;
+        std::vector<unsigned char> records;
+        // Range of each slot, and the slot whose range starts at a record
+        std::vector<LayerRange> ranges;
+        std::vector<int> owners;
+        // Start and length of every hole, neighbouring holes are merged
+        std::map<size_t, size_t> holes;
+        std::set<size_t> skippedHoles;
+        size_t holeRecords;
+        // Written since the last draw, uploaded before it
+        std::vector<LayerRange> dirtyRanges;
+        // The buffer was recreated, every record in use has to be uploaded
+        bool reallocated;
+    };
+
+    std::vector<RetainedLayer> layers;
+    int capturedLayer;
+    int capturedSlot;
+    size_t captureMark;
+    std::vector<unsigned char> slotData;
+
+    size_t queueSize(Primitive primitive) const;
+    void writeLayerSlot(RetainedLayer& layer, int slot, const unsigned char* data, size_t count);
+    size_t allocateLayerRecords(RetainedLayer& layer, size_t count);
+    void freeLayerRecords(RetainedLayer& layer, size_t first, size_t count);
+    void addLayerHole(RetainedLayer& layer, size_t first, size_t count);
+    void removeLayerHole(RetainedLayer& layer, std::map<size_t, size_t>::iterator hole);
+    void compactLayer(RetainedLayer& layer);
+    void uploadLayer(RetainedLayer& layer);
+
+public:
+    // Retained text: glyph quads and width are computed once and reused until the text or scale changes
+    class TextLayout {
+    public:
+        float getWidth() const { return width; }
+
+    private:
+        friend class Renderer;
+        std::string text;
+        float scale = 0.0f;
+        float width = 0.0f;
+        bool valid = false;
+        std::vector<TextVertex> quads;
+    };
+
+    // Draws through the backend, which has to outlive the renderer.
+    // The font is read from memory when fontData is given, from Gill_Sans.otf otherwise.
+    Renderer(RenderBackend& backend, int width, int height, FontMode fontMode = FontMode::Bitmap, const unsigned char* fontData = nullptr, size_t fontSize = 0);
+    ~Renderer();
+    void beginFrame();
+    void setViewport(int width, int height);
+    void setClearColor(const glm::vec4& color);
     void setProjectionMatrix(const glm::mat4& matrix);
     void drawRectangle(float x, float y, float width, float height, const float color[4]);
+    // Rectangle batching: all submitted rectangles are drawn in submission order with one call
+    void beginRectangles();
+    void submitRectangle(float x, float y, float width, float height, const float color[4]);
+    void flushRectangles();
     void drawCircle(float cx, float cy, float r, float* color);
+    // Circle batching: all submitted circles are drawn in submission order with one instanced call
+    void beginCircles();
+    void submitCircle(float cx, float cy, float r, const float color[3]);
+    void flushCircles();
     void drawParkingSpotTimer(float cx, float cy, float r, float redProgress);
+    // Timer batching: one instance record per timer, all drawn with a single call
+    void beginParkingSpotTimers();
+    void submitParkingSpotTimer(float cx, float cy, float r, float redProgress);
+    void flushParkingSpotTimers();
     void drawText(const std::string& text, float x, float y, float scale, glm::vec4 color);
+    // Text batching: every queued string is drawn from the glyph atlas with one call
+    void beginText();
+    void submitText(const std::string& text, float x, float y, float scale, glm::vec4 color);
+    void layoutText(TextLayout& layout, const std::string& text, float scale);
+    void submitText(const TextLayout& layout, float x, float y, glm::vec4 color);
+    void flushText();
     float measureTextWidth(const std::string& text, float scale);
-	void renderImage(GLuint texture, float x, float y, float width, float height, float rotation, float alpha, glm::vec3 blendColor);
+	void renderImage(const TextureRegion& region, float x, float y, float width, float height, float rotation, float alpha, glm::vec3 blendColor);
+
+    // Sprite batching: sprites sharing a texture are drawn with a single instanced call.
+    // Textures are drawn in the order they were first submitted since the last flush.
+    void beginSprites();
+    void submitSprite(const TextureRegion& region, float x, float y, float width, float height, float rotation, float alpha, glm::vec3 blendColor);
+    void flushSprites();
+
+    // Retained layers: submits between beginLayerSlot and endLayerSlot replace the slot's records
+    // instead of going into the frame's queue, a slot takes any number of them. drawLayer uploads the
+    // slots written since the last draw and draws the layer's records with one call per run between large holes.
+    int createLayer(Primitive primitive, int slotCount, GLuint texture = 0);
+    void beginLayerSlot(int layer, int slot);
+    void endLayerSlot();
+    void drawLayer(int layer);
+    // Swaps the texture of a sprite layer, for example once the real image replaces a placeholder
+    void setLayerTexture(int layer, GLuint texture);
+
+    // Static layer cache: draws between beginStaticLayer and endStaticLayer go into an offscreen
+    // target of the given size, drawStaticLayer copies it to the window with a single blit
+    void beginStaticLayer(int width, int height);
+    void endStaticLayer();
+    void drawStaticLayer();
 };
 
 #endif
@@ -0,0 +1,870 @@
+#include "SoftwareBackend.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWARE_BACKEND_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// number conversion warnings
+#pragma warning(disable : 4244)
+
+// Four lanes of floats, pixels are shaded four at a time. SSE2 registers where available, plain arrays otherwise.
+#ifdef SOFTWARE_BACKEND_SSE2
+typedef __m128 Float4;
+typedef __m128 Mask4;
+
+static inline Float4 splat(float value) { return _mm_set1_ps(value); }
+static inline Float4 loadFloats(const float* values) { return _mm_loadu_ps(values); }
+static inline void storeFloats(float* values, Float4 a) { _mm_storeu_ps(values, a); }
+static inline Float4 add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+static inline Float4 sub(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+static inline Float4 mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+static inline Float4 minimum(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+static inline Float4 maximum(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+static inline Float4 truncate(Float4 a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a)); }
+static inline Mask4 less(Float4 a, Float4 b) { return _mm_cmplt_ps(a, b); }
+static inline Mask4 greater(Float4 a, Float4 b) { return _mm_cmpgt_ps(a, b); }
+static inline Mask4 greaterEqual(Float4 a, Float4 b) { return _mm_cmpge_ps(a, b); }
+static inline Mask4 both(Mask4 a, Mask4 b) { return _mm_and_ps(a, b); }
+static inline Float4 select(Mask4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static inline bool anyLane(Mask4 mask) { return _mm_movemask_ps(mask) != 0; }
+static inline bool lane(Mask4 mask, int index) { return (_mm_movemask_ps(mask) >> index) & 1; }
+#else
+struct Float4 {
+    float v[4];
+};
+
+struct Mask4 {
+    bool v[4];
+};
+
+static inline Float4 splat(float value) { Float4 r = { { value, value, value, value } }; return r; }
+static inline Float4 loadFloats(const float* values) { Float4 r; memcpy(r.v, values, sizeof(r.v)); return r; }
+static inline void storeFloats(float* values, Float4 a) { memcpy(values, a.v, sizeof(a.v)); }
+#define LANEWISE(type, expression) type r; for (int i = 0; i < 4; ++i) { r.v[i] = expression; } return r;
+static inline Float4 add(Float4 a, Float4 b) { LANEWISE(Float4, a.v[i] + b.v[i]) }
+static inline Float4 sub(Float4 a, Float4 b) { LANEWISE(Float4, a.v[i] - b.v[i]) }
+static inline Float4 mul(Float4 a, Float4 b) { LANEWISE(Float4, a.v[i] * b.v[i]) }
+static inline Float4 minimum(Float4 a, Float4 b) { LANEWISE(Float4, std::min(a.v[i], b.v[i])) }
+static inline Float4 maximum(Float4 a, Float4 b) { LANEWISE(Float4, std::max(a.v[i], b.v[i])) }
+static inline Float4 truncate(Float4 a) { LANEWISE(Float4, static_cast<float>(static_cast<int>(a.v[i]))) }
+static inline Mask4 less(Float4 a, Float4 b) { LANEWISE(Mask4, a.v[i] < b.v[i]) }
+static inline Mask4 greater(Float4 a, Float4 b) { LANEWISE(Mask4, a.v[i] > b.v[i]) }
+static inline Mask4 greaterEqual(Float4 a, Float4 b) { LANEWISE(Mask4, a.v[i] >= b.v[i]) }
+static inline Mask4 both(Mask4 a, Mask4 b) { LANEWISE(Mask4, a.v[i] && b.v[i]) }
+static inline Float4 select(Mask4 mask, Float4 a, Float4 b) { LANEWISE(Float4, mask.v[i] ? a.v[i] : b.v[i]) }
+#undef LANEWISE
+static inline bool anyLane(Mask4 mask) { return mask.v[0] || mask.v[1] || mask.v[2] || mask.v[3]; }
+static inline bool lane(Mask4 mask, int index) { return mask.v[index]; }
+#endif
+
+// Four RGBA pixels, one channel per Float4 with the pixels in its lanes, values in 0..1
+struct PixelQuad {
+    Float4 r, g, b, a;
+};
+
+static inline PixelQuad splatColor(const glm::vec4& color) {
+    PixelQuad quad = { splat(color.r), splat(color.g), splat(color.b), splat(color.a) };
+    return quad;
+}
+
+// Lanes past the count read as transparent black and are not written back, so quads never touch another tile
+static inline PixelQuad loadQuad(const unsigned char* pixels, int count) {
+    unsigned char bytes[16] = {};
+    if (count >= 4) {
+        memcpy(bytes, pixels, 16);
+    }
+    else {
+        memcpy(bytes, pixels, count * 4);
+    }
+#ifdef SOFTWARE_BACKEND_SSE2
+    __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+    __m128i byteMask = _mm_set1_epi32(0xFF);
+    __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    PixelQuad quad;
+    quad.r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(packed, byteMask)), scale);
+    quad.g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 8), byteMask)), scale);
+    quad.b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 16), byteMask)), scale);
+    quad.a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(packed, 24)), scale);
+    return quad;
+#else
+    PixelQuad quad;
+    for (int i = 0; i < 4; ++i) {
+        quad.r.v[i] = bytes[i * 4 + 0] / 255.0f;
+        quad.g.v[i] = bytes[i * 4 + 1] / 255.0f;
+        quad.b.v[i] = bytes[i * 4 + 2] / 255.0f;
+        quad.a.v[i] = bytes[i * 4 + 3] / 255.0f;
+    }
+    return quad;
+#endif
+}
+
+static inline void storeQuad(unsigned char* pixels, const PixelQuad& quad, int count) {
+    unsigned char bytes[16];
+#ifdef SOFTWARE_BACKEND_SSE2
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 scale = _mm_set1_ps(255.0f);
+    __m128i r = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(quad.r, zero), one), scale));
+    __m128i g = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(quad.g, zero), one), scale));
+    __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(quad.b, zero), one), scale));
+    __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(quad.a, zero), one), scale));
+    __m128i packed = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(bytes), packed);
+#else
+    for (int i = 0; i < 4; ++i) {
+        bytes[i * 4 + 0] = static_cast<unsigned char>(std::min(std::max(quad.r.v[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+        bytes[i * 4 + 1] = static_cast<unsigned char>(std::min(std::max(quad.g.v[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+        bytes[i * 4 + 2] = static_cast<unsigned char>(std::min(std::max(quad.b.v[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+        bytes[i * 4 + 3] = static_cast<unsigned char>(std::min(std::max(quad.a.v[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+#endif
+    if (count >= 4) {
+        memcpy(pixels, bytes, 16);
+    }
+    else {
+        memcpy(pixels, bytes, count * 4);
+    }
+}
+
+// Source over destination by the source alpha, on all four channels like glBlendFunc.
+// Lanes outside the mask keep the destination.
+static inline void blendQuad(unsigned char* pixels, int count, const PixelQuad& source, Mask4 mask) {
+    PixelQuad destination = loadQuad(pixels, count);
+    Float4 alpha = select(mask, source.a, splat(0.0f));
+    destination.r = add(destination.r, mul(sub(source.r, destination.r), alpha));
+    destination.g = add(destination.g, mul(sub(source.g, destination.g), alpha));
+    destination.b = add(destination.b, mul(sub(source.b, destination.b), alpha));
+    destination.a = add(destination.a, mul(sub(source.a, destination.a), alpha));
+    storeQuad(pixels, destination, count);
+}
+
+static void blendSpan(unsigned char* pixels, int count, const glm::vec4& color) {
+    if (color.a >= 1.0f) {
+        // Opaque, a plain fill
+        unsigned char packed[16];
+        storeQuad(packed, splatColor(color), 1);
+        for (int i = 0; i < count; ++i) {
+            memcpy(pixels + i * 4, packed, 4);
+        }
+    }
+    else if (color.a > 0.0f) {
+        PixelQuad source = splatColor(color);
+        Mask4 all = greaterEqual(splat(0.0f), splat(0.0f));
+        for (int i = 0; i < count; i += 4) {
+            blendQuad(pixels + i * 4, count - i, source, all);
+        }
+    }
+}
+
+// Texture coordinates are never far below 0, truncation of the shifted value floors them without a libm call
+static inline int fastFloor(float value) {
+    return static_cast<int>(value + 65536.0f) - 65536;
+}
+
+// Bilinear footprint with texel centers at half coordinates and clamped edges like GL_LINEAR.
+// The footprint is kept inside the texture, so the right and lower texels always follow the first one.
+struct Footprint {
+    int x, y;
+    float fx, fy;
+};
+
+static inline Footprint getFootprint(float u, float v, int width, int height) {
+    float x = u * width - 0.5f;
+    float y = v * height - 0.5f;
+    Footprint footprint = { fastFloor(x), fastFloor(y), 0.0f, 0.0f };
+    footprint.fx = x - footprint.x;
+    footprint.fy = y - footprint.y;
+    if (footprint.x < 0) {
+        footprint.x = 0;
+        footprint.fx = 0.0f;
+    }
+    else if (footprint.x > width - 2) {
+        footprint.x = std::max(width - 2, 0);
+        footprint.fx = width > 1 ? 1.0f : 0.0f;
+    }
+    if (footprint.y < 0) {
+        footprint.y = 0;
+        footprint.fy = 0.0f;
+    }
+    else if (footprint.y > height - 2) {
+        footprint.y = std::max(height - 2, 0);
+        footprint.fy = height > 1 ? 1.0f : 0.0f;
+    }
+    return footprint;
+}
+
+// RGBA lookups for the four lanes. The footprints are clamped into the texture,
+// so every lane can be fetched and the caller masks the ones it doesn't need.
+static PixelQuad sampleQuad(const unsigned char* texels, int width, int height, const Float4& u, const Float4& v) {
+    // Same footprint as getFootprint, the last texel pairs with the one before it
+    Float4 x = minimum(maximum(sub(mul(u, splat(static_cast<float>(width))), splat(0.5f)), splat(0.0f)), splat(width - 1.0f));
+    Float4 y = minimum(maximum(sub(mul(v, splat(static_cast<float>(height))), splat(0.5f)), splat(0.0f)), splat(height - 1.0f));
+    Float4 left = minimum(truncate(x), splat(std::max(width - 2, 0) * 1.0f));
+    Float4 top = minimum(truncate(y), splat(std::max(height - 2, 0) * 1.0f));
+    Float4 fx = sub(x, left);
+    Float4 fy = sub(y, top);
+
+    float lefts[4], tops[4];
+    storeFloats(lefts, left);
+    storeFloats(tops, top);
+
+    // 1 texel wide or high textures have no neighbour to pair with
+    size_t stepX = width > 1 ? 4 : 0;
+    size_t stepY = height > 1 ? static_cast<size_t>(width) * 4 : 0;
+    unsigned char corners[4][16];
+    for (int i = 0; i < 4; ++i) {
+        const unsigned char* texel = texels + (static_cast<size_t>(tops[i]) * width + static_cast<size_t>(lefts[i])) * 4;
+        memcpy(corners[0] + i * 4, texel, 4);
+        memcpy(corners[1] + i * 4, texel + stepX, 4);
+        memcpy(corners[2] + i * 4, texel + stepY, 4);
+        memcpy(corners[3] + i * 4, texel + stepY + stepX, 4);
+    }
+
+    Float4 one = splat(1.0f);
+    Float4 weights[4] = {
+        mul(sub(one, fx), sub(one, fy)),
+        mul(fx, sub(one, fy)),
+        mul(sub(one, fx), fy),
+        mul(fx, fy)
+    };
+
+    // Weighted sum of the corner quads, every lane with its own weights
+    PixelQuad result = splatColor(glm::vec4(0.0f));
+    for (int corner = 0; corner < 4; ++corner) {
+        PixelQuad texel = loadQuad(corners[corner], 4);
+        result.r = add(result.r, mul(texel.r, weights[corner]));
+        result.g = add(result.g, mul(texel.g, weights[corner]));
+        result.b = add(result.b, mul(texel.b, weights[corner]));
+        result.a = add(result.a, mul(texel.a, weights[corner]));
+    }
+    return result;
+}
+
+static inline float sampleRed(const unsigned char* texels, int width, int height, float u, float v) {
+    Footprint footprint = getFootprint(u, v, width, height);
+    int stepX = width > 1 ? 1 : 0;
+    int stepY = height > 1 ? width : 0;
+    const unsigned char* top = texels + static_cast<size_t>(footprint.y) * width + footprint.x;
+    float upper = top[0] + (top[stepX] - top[0]) * footprint.fx;
+    float lower = top[stepY] + (top[stepY + stepX] - top[stepY]) * footprint.fx;
+    return (upper + (lower - upper) * footprint.fy) / 255.0f;
+}
+
+// Signed distance of the point from the edge a to b, positive on its left
+struct Edge {
+    glm::vec2 a, delta;
+    // Pixel centers exactly on the edge belong to the triangle left of or below it, so triangles
+    // sharing the edge don't blend it twice. Triangles are counter-clockwise with y up.
+    bool topLeft;
+
+    Edge(const glm::vec2& a, const glm::vec2& b) : a(a), delta(b - a), topLeft(b.y < a.y || (b.y == a.y && b.x < a.x)) {}
+
+    float at(float x, float y) const {
+        return delta.x * (y - a.y) - delta.y * (x - a.x);
+    }
+
+    // Four pixel centers of a row at once
+    Float4 at(Float4 x, float y) const {
+        return sub(splat(delta.x * (y - a.y)), mul(splat(delta.y), sub(x, splat(a.x))));
+    }
+
+    Mask4 inside(Float4 distance) const {
+        return topLeft ? greaterEqual(distance, splat(0.0f)) : greater(distance, splat(0.0f));
+    }
+};
+
+// Narrows the pixel range [first, last) of a row to where 0 <= start + step * i < 1 can hold,
+// one pixel wider for rounding so the exact test stays per pixel
+static void narrowToUnitRange(float start, float step, int& first, int& last) {
+    if (step == 0.0f) {
+        if (start < 0.0f || start >= 1.0f) {
+            last = first;
+        }
+        return;
+    }
+
+    float enter = -start / step;
+    float leave = (1.0f - start) / step;
+    if (enter > leave) {
+        std::swap(enter, leave);
+    }
+    first = std::max(first, static_cast<int>(std::max(std::floor(enter), -1.0f)) - 1);
+    last = std::min(last, static_cast<int>(std::min(std::ceil(leave), 1e9f)) + 1);
+}
+
+static inline float smoothStep(float edge0, float edge1, float x) {
+    float t = std::min(std::max((x - edge0) / (edge1 - edge0), 0.0f), 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+SoftwareBackend::SoftwareBackend(TaskPool& pool) : target(&screen), viewportSize(0.0f), tilesX(0), tilesY(0), pool(pool) {
+}
+
+void SoftwareBackend::finish() {
+    if (shapes.empty()) {
+        return;
+    }
+
+    PROFILE_SCOPE("rasterize");
+    // One tile per chunk, the calling thread shades tiles too
+    pool.parallelFor(static_cast<size_t>(tilesX * tilesY), 1, [this](size_t begin, size_t end) {
+        PROFILE_SCOPE("shade tiles");
+        for (size_t tile = begin; tile < end; ++tile) {
+            shadeTile(static_cast<int>(tile));
+        }
+    });
+
+    shapes.clear();
+    for (std::vector<uint32_t>& bin : tileBins) {
+        bin.clear();
+    }
+}
+
+const std::vector<unsigned char>& SoftwareBackend::getFramebuffer() {
+    finish();
+    return screen.pixels;
+}
+
+int SoftwareBackend::getWidth() const {
+    return screen.width;
+}
+
+int SoftwareBackend::getHeight() const {
+    return screen.height;
+}
+
+bool SoftwareBackend::saveFrame(const std::string& path) {
+    finish();
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "ERROR::SOFTWARE: Could not write " << path << std::endl;
+        return false;
+    }
+
+    out << "P6\n" << screen.width << " " << screen.height << "\n255\n";
+    std::vector<char> row(static_cast<size_t>(screen.width) * 3);
+    for (int y = screen.height - 1; y >= 0; --y) {
+        const unsigned char* source = screen.pixels.data() + static_cast<size_t>(y) * screen.width * 4;
+        for (int x = 0; x < screen.width; ++x) {
+            row[x * 3 + 0] = source[x * 4 + 0];
+            row[x * 3 + 1] = source[x * 4 + 1];
+            row[x * 3 + 2] = source[x * 4 + 2];
+        }
+        out.write(row.data(), row.size());
+    }
+    return static_cast<bool>(out);
+}
+
+void SoftwareBackend::beginFrame() {
+    // Whatever the last frame left pending still lands in its framebuffer
+    finish();
+    RecordingBackend::beginFrame();
+    // Not cleared, same as with the GL backend: the static layer covers the window
+    bindTarget(screen);
+}
+
+void SoftwareBackend::setViewport(int width, int height) {
+    finish();
+    RecordingBackend::setViewport(width, height);
+    viewportSize = glm::vec2(width, height);
+
+    screen.width = std::max(width, 0);
+    screen.height = std::max(height, 0);
+    screen.pixels.assign(static_cast<size_t>(screen.width) * screen.height * 4, 0);
+    bindTarget(*target);
+}
+
+void SoftwareBackend::uploadTexture(GLuint texture, const TextureDesc& desc, const unsigned char* const* levels) {
+    // Pending shapes point at the old pixels
+    finish();
+    RecordingBackend::uploadTexture(texture, desc, levels);
+}
+
+void SoftwareBackend::deleteTexture(GLuint texture) {
+    finish();
+    RecordingBackend::deleteTexture(texture);
+}
+
+glm::vec2 SoftwareBackend::toPixels(const glm::vec2& position) const {
+    glm::vec4 clip = getProjectionMatrix() * glm::vec4(position, 0.0f, 1.0f);
+    return (glm::vec2(clip) * 0.5f + 0.5f) * viewportSize;
+}
+
+void SoftwareBackend::bindTarget(Target& newTarget) {
+    finish();
+    target = &newTarget;
+    tilesX = (target->width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (target->height + TILE_SIZE - 1) / TILE_SIZE;
+    tileBins.resize(static_cast<size_t>(tilesX) * tilesY);
+}
+
+void SoftwareBackend::clearTarget(Target& clearedTarget) {
+    unsigned char packed[16];
+    storeQuad(packed, splatColor(getClearColor()), 1);
+    for (size_t i = 0; i < clearedTarget.pixels.size(); i += 4) {
+        memcpy(&clearedTarget.pixels[i], packed, 4);
+    }
+}
+
+// Clips the bounds to the target and adds the shape to the bins of every tile it touches
+void SoftwareBackend::addShape(Shape& shape) {
+    shape.minX = std::max(shape.minX, 0);
+    shape.minY = std::max(shape.minY, 0);
+    shape.maxX = std::min(shape.maxX, target->width - 1);
+    shape.maxY = std::min(shape.maxY, target->height - 1);
+    if (shape.minX > shape.maxX || shape.minY > shape.maxY) {
+        return;
+    }
+
+    uint32_t index = static_cast<uint32_t>(shapes.size());
+    shapes.push_back(shape);
+    for (int tileY = shape.minY / TILE_SIZE; tileY <= shape.maxY / TILE_SIZE; ++tileY) {
+        for (int tileX = shape.minX / TILE_SIZE; tileX <= shape.maxX / TILE_SIZE; ++tileX) {
+            tileBins[tileY * tilesX + tileX].push_back(index);
+        }
+    }
+}
+
+void SoftwareBackend::addTriangle(ShapeType type, const glm::vec2* positions, const glm::vec4* colors, const glm::vec2* uvs, const DrawCall& call) {
+    Shape shape = {};
+    shape.type = type;
+    for (int i = 0; i < 3; ++i) {
+        shape.points[i] = toPixels(positions[i]);
+        shape.colors[i] = colors[i];
+        shape.uvs[i] = uvs ? uvs[i] : glm::vec2(0.0f);
+    }
+
+    // Zeroed layer records collapse to nothing
+    float area = Edge(shape.points[0], shape.points[1]).at(shape.points[2].x, shape.points[2].y);
+    if (area == 0.0f) {
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(shape.points[1], shape.points[2]);
+        std::swap(shape.colors[1], shape.colors[2]);
+        std::swap(shape.uvs[1], shape.uvs[2]);
+    }
+
+    if (type == ShapeType::GlyphTriangle) {
+        const TextureDesc* desc = getTextureDesc(call.texture);
+        const std::vector<unsigned char>& texels = getTexturePixels(call.texture);
+        if (!desc || texels.empty() || desc->format != TextureFormat::Red) {
+            return;
+        }
+        shape.texels = texels.data();
+        shape.textureWidth = desc->width;
+        shape.textureHeight = desc->height;
+        shape.distanceField = call.distanceField;
+    }
+
+    glm::vec2 low = glm::min(shape.points[0], glm::min(shape.points[1], shape.points[2]));
+    glm::vec2 high = glm::max(shape.points[0], glm::max(shape.points[1], shape.points[2]));
+    shape.minX = static_cast<int>(std::floor(low.x));
+    shape.minY = static_cast<int>(std::floor(low.y));
+    shape.maxX = static_cast<int>(std::ceil(high.x));
+    shape.maxY = static_cast<int>(std::ceil(high.y));
+    addShape(shape);
+}
+
+void SoftwareBackend::draw(const DrawCall& call) {
+    RecordingBackend::draw(call);
+
+    const std::vector<unsigned char>& buffer = getBufferData(call.buffer);
+    const unsigned char* records = buffer.data() + call.offset;
+    size_t available = call.offset < buffer.size() ? buffer.size() - call.offset : 0;
+    // Pixels per unit, the renderer's projections scale both axes alike
+    float scale = getProjectionMatrix()[0][0] * 0.5f * viewportSize.x;
+
+    switch (call.primitive) {
+    case RenderPrimitive::Rectangle: {
+        size_t count = std::min(static_cast<size_t>(call.count), available / sizeof(ColorVertex)) / 3 * 3;
+        const ColorVertex* vertices = reinterpret_cast<const ColorVertex*>(records);
+        for (size_t i = 0; i < count; i += 3) {
+            glm::vec2 positions[3];
+            glm::vec4 colors[3];
+            for (int corner = 0; corner < 3; ++corner) {
+                const ColorVertex& vertex = vertices[i + corner];
+                positions[corner] = glm::vec2(vertex.x, vertex.y);
+                colors[corner] = glm::vec4(vertex.r, vertex.g, vertex.b, vertex.a);
+            }
+            addTriangle(ShapeType::Triangle, positions, colors, nullptr, call);
+        }
+        break;
+    }
+
+    case RenderPrimitive::Text: {
+        size_t count = std::min(static_cast<size_t>(call.count), available / sizeof(TextVertex)) / 3 * 3;
+        const TextVertex* vertices = reinterpret_cast<const TextVertex*>(records);
+        for (size_t i = 0; i < count; i += 3) {
+            glm::vec2 positions[3];
+            glm::vec4 colors[3];
+            glm::vec2 uvs[3];
+            for (int corner = 0; corner < 3; ++corner) {
+                const TextVertex& vertex = vertices[i + corner];
+                positions[corner] = glm::vec2(vertex.x, vertex.y);
+                colors[corner] = glm::vec4(vertex.r, vertex.g, vertex.b, vertex.a);
+                uvs[corner] = glm::vec2(vertex.u, vertex.v);
+            }
+            addTriangle(ShapeType::GlyphTriangle, positions, colors, uvs, call);
+        }
+        break;
+    }
+
+    case RenderPrimitive::Circle: {
+        size_t count = std::min(static_cast<size_t>(call.count), available / sizeof(CircleInstance));
+        const CircleInstance* circles = reinterpret_cast<const CircleInstance*>(records);
+        for (size_t i = 0; i < count; ++i) {
+            const CircleInstance& circle = circles[i];
+            if (circle.r <= 0.0f) {
+                continue;
+            }
+
+            Shape shape = {};
+            shape.type = ShapeType::Disc;
+            shape.points[0] = toPixels(glm::vec2(circle.cx, circle.cy));
+            shape.radius = circle.r * scale;
+            shape.colors[0] = glm::vec4(circle.red, circle.green, circle.blue, circle.alpha);
+            shape.minX = static_cast<int>(std::floor(shape.points[0].x - shape.radius));
+            shape.minY = static_cast<int>(std::floor(shape.points[0].y - shape.radius));
+            shape.maxX = static_cast<int>(std::ceil(shape.points[0].x + shape.radius));
+            shape.maxY = static_cast<int>(std::ceil(shape.points[0].y + shape.radius));
+            addShape(shape);
+        }
+        break;
+    }
+
+    case RenderPrimitive::Timer: {
+        size_t count = std::min(static_cast<size_t>(call.count), available / sizeof(TimerInstance));
+        const TimerInstance* timers = reinterpret_cast<const TimerInstance*>(records);
+        for (size_t i = 0; i < count; ++i) {
+            const TimerInstance& timer = timers[i];
+            if (timer.r <= 0.0f) {
+                continue;
+            }
+
+            // One extra pixel for the anti-aliased rim
+            Shape shape = {};
+            shape.type = ShapeType::Timer;
+            shape.points[0] = toPixels(glm::vec2(timer.cx, timer.cy));
+            shape.radius = timer.r * scale;
+            shape.progress = timer.redProgress;
+            shape.minX = static_cast<int>(std::floor(shape.points[0].x - shape.radius - 1.0f));
+            shape.minY = static_cast<int>(std::floor(shape.points[0].y - shape.radius - 1.0f));
+            shape.maxX = static_cast<int>(std::ceil(shape.points[0].x + shape.radius + 1.0f));
+            shape.maxY = static_cast<int>(std::ceil(shape.points[0].y + shape.radius + 1.0f));
+            addShape(shape);
+        }
+        break;
+    }
+
+    case RenderPrimitive::Sprite: {
+        const TextureDesc* desc = getTextureDesc(call.texture);
+        const std::vector<unsigned char>& texels = getTexturePixels(call.texture);
+        if (!desc || texels.empty() || desc->format != TextureFormat::RGBA) {
+            break;
+        }
+
+        size_t count = std::min(static_cast<size_t>(call.count), available / sizeof(SpriteInstance));
+        const SpriteInstance* sprites = reinterpret_cast<const SpriteInstance*>(records);
+        for (size_t i = 0; i < count; ++i) {
+            const SpriteInstance& sprite = sprites[i];
+            if (sprite.width == 0.0f || sprite.height == 0.0f) {
+                continue;
+            }
+
+            // Same corners as the vertex shader: the quad rotated around its center, in degrees
+            float angle = glm::radians(sprite.rotation);
+            glm::vec2 size(sprite.width, sprite.height);
+            glm::vec2 center = glm::vec2(sprite.x, sprite.y) + 0.5f * size;
+            glm::vec2 corners[3] = { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 1.0f) };
+            for (glm::vec2& corner : corners) {
+                glm::vec2 local = (corner - 0.5f) * size;
+                glm::vec2 rotated(local.x * std::cos(angle) - local.y * std::sin(angle), local.x * std::sin(angle) + local.y * std::cos(angle));
+                corner = toPixels(center + rotated);
+            }
+
+            Shape shape = {};
+            shape.type = ShapeType::Sprite;
+            shape.points[0] = corners[0];
+            shape.points[1] = corners[1] - corners[0];
+            shape.points[2] = corners[2] - corners[0];
+            if (shape.points[1].x * shape.points[2].y - shape.points[1].y * shape.points[2].x == 0.0f) {
+                continue;
+            }
+            shape.uvs[0] = glm::vec2(sprite.u0, sprite.v0);
+            shape.uvs[1] = glm::vec2(sprite.u1, sprite.v1);
+            shape.colors[0] = glm::vec4(sprite.r, sprite.g, sprite.b, sprite.alpha);
+            shape.texels = texels.data();
+            shape.textureWidth = desc->width;
+            shape.textureHeight = desc->height;
+
+            glm::vec2 far = shape.points[0] + shape.points[1] + shape.points[2];
+            glm::vec2 low = glm::min(glm::min(corners[0], corners[1]), glm::min(corners[2], far));
+            glm::vec2 high = glm::max(glm::max(corners[0], corners[1]), glm::max(corners[2], far));
+            shape.minX = static_cast<int>(std::floor(low.x));
+            shape.minY = static_cast<int>(std::floor(low.y));
+            shape.maxX = static_cast<int>(std::ceil(high.x));
+            shape.maxY = static_cast<int>(std::ceil(high.y));
+            addShape(shape);
+        }
+        break;
+    }
+    }
+}
+
+void SoftwareBackend::beginOffscreen(int width, int height) {
+    RecordingBackend::beginOffscreen(width, height);
+    finish();
+
+    if (offscreen.width != width || offscreen.height != height) {
+        offscreen.width = std::max(width, 0);
+        offscreen.height = std::max(height, 0);
+        offscreen.pixels.assign(static_cast<size_t>(offscreen.width) * offscreen.height * 4, 0);
+    }
+    bindTarget(offscreen);
+    clearTarget(offscreen);
+}
+
+void SoftwareBackend::endOffscreen() {
+    RecordingBackend::endOffscreen();
+    bindTarget(screen);
+}
+
+void SoftwareBackend::drawOffscreen() {
+    RecordingBackend::drawOffscreen();
+    finish();
+
+    // Copied unblended from the lower left corner, like the blit
+    int width = std::min(offscreen.width, screen.width);
+    int height = std::min(offscreen.height, screen.height);
+    for (int y = 0; y < height; ++y) {
+        memcpy(&screen.pixels[static_cast<size_t>(y) * screen.width * 4], &offscreen.pixels[static_cast<size_t>(y) * offscreen.width * 4], static_cast<size_t>(width) * 4);
+    }
+}
+
+// Shades the tile's shapes in submission order, each clipped to the tile, four pixels at a time
+void SoftwareBackend::shadeTile(int tile) {
+    static const float LANE_INDICES[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const Float4 laneIndices = loadFloats(LANE_INDICES);
+    const Float4 laneCenters = add(laneIndices, splat(0.5f));
+
+    const int tileX0 = (tile % tilesX) * TILE_SIZE;
+    const int tileY0 = (tile / tilesX) * TILE_SIZE;
+    const int tileX1 = std::min(tileX0 + TILE_SIZE, target->width);
+    const int tileY1 = std::min(tileY0 + TILE_SIZE, target->height);
+    const int stride = target->width * 4;
+    unsigned char* pixels = target->pixels.data();
+
+    for (uint32_t index : tileBins[tile]) {
+        const Shape& shape = shapes[index];
+        const int x0 = std::max(tileX0, shape.minX);
+        const int y0 = std::max(tileY0, shape.minY);
+        const int x1 = std::min(tileX1, shape.maxX + 1);
+        const int y1 = std::min(tileY1, shape.maxY + 1);
+
+        switch (shape.type) {
+        case ShapeType::Triangle:
+        case ShapeType::GlyphTriangle: {
+            const Edge edge0(shape.points[1], shape.points[2]);
+            const Edge edge1(shape.points[2], shape.points[0]);
+            const Edge edge2(shape.points[0], shape.points[1]);
+            const float area = edge2.at(shape.points[2].x, shape.points[2].y);
+            const bool glyph = shape.type == ShapeType::GlyphTriangle;
+            const bool flat = shape.colors[0] == shape.colors[1] && shape.colors[1] == shape.colors[2];
+
+            // UVs are affine over the triangle, so their change per pixel is constant. The plane is anchored
+            // at the first vertex, anchored at the window origin it loses texels to cancellation far from it.
+            const glm::vec2 anchor = shape.points[0];
+            const glm::vec2 edgeA = shape.points[1] - anchor;
+            const glm::vec2 edgeB = shape.points[2] - anchor;
+            const glm::vec2 uvEdgeA = shape.uvs[1] - shape.uvs[0];
+            const glm::vec2 uvEdgeB = shape.uvs[2] - shape.uvs[0];
+            const float determinant = edgeA.x * edgeB.y - edgeA.y * edgeB.x;
+            const glm::vec2 uvStepX = (uvEdgeA * edgeB.y - uvEdgeB * edgeA.y) / determinant;
+            const glm::vec2 uvStepY = (uvEdgeB * edgeA.x - uvEdgeA * edgeB.x) / determinant;
+            // Either triangle of a glyph quad spans the glyph's whole atlas cell
+            const glm::vec2 uvMin = glm::min(glm::min(shape.uvs[0], shape.uvs[1]), shape.uvs[2]);
+            const glm::vec2 uvMax = glm::max(glm::max(shape.uvs[0], shape.uvs[1]), shape.uvs[2]);
+
+            for (int y = y0; y < y1; ++y) {
+                const float py = y + 0.5f;
+                unsigned char* row = pixels + static_cast<size_t>(y) * stride;
+                for (int x = x0; x < x1; x += 4) {
+                    Float4 px = add(splat(static_cast<float>(x)), laneCenters);
+                    Float4 w0 = edge0.at(px, py);
+                    Float4 w1 = edge1.at(px, py);
+                    Float4 w2 = edge2.at(px, py);
+                    Mask4 inside = both(both(edge0.inside(w0), edge1.inside(w1)), edge2.inside(w2));
+                    if (!anyLane(inside)) {
+                        continue;
+                    }
+
+                    PixelQuad color = splatColor(shape.colors[0]);
+                    if (!flat) {
+                        Float4 b0 = mul(w0, splat(1.0f / area));
+                        Float4 b1 = mul(w1, splat(1.0f / area));
+                        Float4 b2 = mul(w2, splat(1.0f / area));
+                        const glm::vec4* c = shape.colors;
+                        color.r = add(add(mul(b0, splat(c[0].r)), mul(b1, splat(c[1].r))), mul(b2, splat(c[2].r)));
+                        color.g = add(add(mul(b0, splat(c[0].g)), mul(b1, splat(c[1].g))), mul(b2, splat(c[2].g)));
+                        color.b = add(add(mul(b0, splat(c[0].b)), mul(b1, splat(c[1].b))), mul(b2, splat(c[2].b)));
+                        color.a = add(add(mul(b0, splat(c[0].a)), mul(b1, splat(c[1].a))), mul(b2, splat(c[2].a)));
+                    }
+
+                    if (glyph) {
+                        float coverage[4] = {};
+                        for (int i = 0; i < 4; ++i) {
+                            if (!lane(inside, i)) {
+                                continue;
+                            }
+                            glm::vec2 uv = shape.uvs[0] + uvStepX * (x + i + 0.5f - anchor.x) + uvStepY * (py - anchor.y);
+                            float sampled = sampleRed(shape.texels, shape.textureWidth, shape.textureHeight, uv.x, uv.y);
+                            if (shape.distanceField) {
+                                // fwidth from the neighbouring pixels, like the derivatives of a 2x2 pixel quad.
+                                // Kept inside the glyph's cell so the field of the next glyph doesn't widen the edge.
+                                glm::vec2 right = glm::clamp(uv + uvStepX, uvMin, uvMax);
+                                glm::vec2 up = glm::clamp(uv + uvStepY, uvMin, uvMax);
+                                float rightSample = sampleRed(shape.texels, shape.textureWidth, shape.textureHeight, right.x, right.y);
+                                float upSample = sampleRed(shape.texels, shape.textureWidth, shape.textureHeight, up.x, up.y);
+                                float width = std::max(std::abs(rightSample - sampled) + std::abs(upSample - sampled), 0.0001f);
+                                coverage[i] = smoothStep(0.5f - width, 0.5f + width, sampled);
+                            }
+                            else {
+                                coverage[i] = sampled;
+                            }
+                        }
+                        color.a = mul(color.a, loadFloats(coverage));
+                    }
+
+                    blendQuad(row + x * 4, x1 - x, color, inside);
+                }
+            }
+            break;
+        }
+
+        case ShapeType::Disc: {
+            const glm::vec2 center = shape.points[0];
+            for (int y = y0; y < y1; ++y) {
+                float dy = y + 0.5f - center.y;
+                float squared = shape.radius * shape.radius - dy * dy;
+                if (squared < 0.0f) {
+                    continue;
+                }
+                float halfWidth = std::sqrt(squared);
+                int start = std::max(x0, static_cast<int>(std::ceil(center.x - halfWidth - 0.5f)));
+                int end = std::min(x1, static_cast<int>(std::floor(center.x + halfWidth - 0.5f)) + 1);
+                if (start < end) {
+                    blendSpan(pixels + static_cast<size_t>(y) * stride + start * 4, end - start, shape.colors[0]);
+                }
+            }
+            break;
+        }
+
+        case ShapeType::Timer: {
+            // Same as the timer shader, with distances in pixels the rim is one pixel wide
+            const glm::vec2 center = shape.points[0];
+            const float split = (1.0f - shape.progress) * 2.0f * M_PI;
+            for (int y = y0; y < y1; ++y) {
+                const float localY = y + 0.5f - center.y;
+                unsigned char* row = pixels + static_cast<size_t>(y) * stride;
+                for (int x = x0; x < x1; x += 4) {
+                    float greens[4] = {};
+                    float coverages[4] = {};
+                    for (int i = 0; i < 4; ++i) {
+                        float localX = x + i + 0.5f - center.x;
+                        float dist = std::sqrt(localX * localX + localY * localY);
+                        coverages[i] = std::min(std::max(shape.radius - dist + 0.5f, 0.0f), 1.0f);
+                        if (coverages[i] <= 0.0f) {
+                            continue;
+                        }
+
+                        if (shape.progress <= 0.0f) {
+                            greens[i] = 1.0f;
+                        }
+                        else if (shape.progress < 1.0f) {
+                            float angle = std::fmod(std::atan2(localY, localX) - M_PI / 2.0f + 2.0f * M_PI, 2.0f * M_PI);
+                            float insideGreen = std::min(split - angle, angle) * dist;
+                            float pastStart = (2.0f * M_PI - angle) * dist;
+                            greens[i] = std::max(std::min(std::max(insideGreen + 0.5f, 0.0f), 1.0f), std::min(std::max(0.5f - pastStart, 0.0f), 1.0f));
+                        }
+                    }
+
+                    Float4 coverage = loadFloats(coverages);
+                    Mask4 inside = greater(coverage, splat(0.0f));
+                    if (!anyLane(inside)) {
+                        continue;
+                    }
+                    Float4 green = loadFloats(greens);
+                    PixelQuad color = { sub(splat(1.0f), green), green, splat(0.0f), coverage };
+                    blendQuad(row + x * 4, x1 - x, color, inside);
+                }
+            }
+            break;
+        }
+
+        case ShapeType::Sprite: {
+            // Quad coordinates of the pixel center, from the inverse of the edge matrix
+            const glm::vec2 origin = shape.points[0];
+            const glm::vec2 edgeX = shape.points[1];
+            const glm::vec2 edgeY = shape.points[2];
+            const float determinant = edgeX.x * edgeY.y - edgeX.y * edgeY.x;
+            const float sStep = edgeY.y / determinant;
+            const float tStep = -edgeX.y / determinant;
+            const glm::vec2 uvSize = shape.uvs[1] - shape.uvs[0];
+            const glm::vec4 tint = shape.colors[0];
+
+            for (int y = y0; y < y1; ++y) {
+                float dx = x0 + 0.5f - origin.x;
+                float dy = y + 0.5f - origin.y;
+                float rowS = (dx * edgeY.y - dy * edgeY.x) / determinant;
+                float rowT = (edgeX.x * dy - edgeX.y * dx) / determinant;
+
+                // Skip the parts of the row outside a rotated quad
+                int first = 0, last = x1 - x0;
+                narrowToUnitRange(rowS, sStep, first, last);
+                narrowToUnitRange(rowT, tStep, first, last);
+
+                unsigned char* row = pixels + static_cast<size_t>(y) * stride + x0 * 4;
+                for (int i = first; i < last; i += 4) {
+                    Float4 offsets = add(splat(static_cast<float>(i)), laneIndices);
+                    Float4 s = add(splat(rowS), mul(splat(sStep), offsets));
+                    Float4 t = add(splat(rowT), mul(splat(tStep), offsets));
+                    Mask4 inside = both(both(greaterEqual(s, splat(0.0f)), less(s, splat(1.0f))), both(greaterEqual(t, splat(0.0f)), less(t, splat(1.0f))));
+                    if (!anyLane(inside)) {
+                        continue;
+                    }
+
+                    Float4 u = add(splat(shape.uvs[0].x), mul(splat(uvSize.x), s));
+                    Float4 v = add(splat(shape.uvs[0].y), mul(splat(uvSize.y), t));
+                    PixelQuad texel = sampleQuad(shape.texels, shape.textureWidth, shape.textureHeight, u, v);
+
+                    // Near-white texels take the blend color, as in the image shader
+                    Float4 r = sub(splat(1.0f), texel.r);
+                    Float4 g = sub(splat(1.0f), texel.g);
+                    Float4 b = sub(splat(1.0f), texel.b);
+                    Mask4 white = less(add(add(mul(r, r), mul(g, g)), mul(b, b)), splat(1.0f));
+                    PixelQuad color;
+                    color.r = select(white, splat(tint.r), texel.r);
+                    color.g = select(white, splat(tint.g), texel.g);
+                    color.b = select(white, splat(tint.b), texel.b);
+                    color.a = mul(texel.a, splat(tint.a));
+                    blendQuad(row + i * 4, last - i, color, inside);
+                }
+            }
+            break;
+        }
+        }
+    }
+}
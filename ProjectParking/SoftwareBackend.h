@@ -0,0 +1,86 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RecordingBackend.h"
+#include "TaskPool.h"
+
+#ifndef SOFTWARE_BACKEND_H
+#define SOFTWARE_BACKEND_H
+
+// Rasterizes the draws into an RGBA framebuffer on the CPU, on top of recording them.
+// Draws are set up in pixel space and binned into tiles, the tiles are shaded in parallel
+// on the thread pool when the frame is finished. Blending matches the GL backend: source alpha, one minus source alpha.
+class SoftwareBackend : public RecordingBackend {
+public:
+    static const int TILE_SIZE = 64;
+
+    SoftwareBackend(TaskPool& pool);
+
+    // Shades the pending draws. Runs by itself before anything reads the framebuffer.
+    void finish();
+    // Rows are bottom up like the GL default framebuffer
+    const std::vector<unsigned char>& getFramebuffer();
+    int getWidth() const;
+    int getHeight() const;
+    // Writes the framebuffer as a binary PPM, top row first
+    bool saveFrame(const std::string& path);
+
+    void beginFrame() override;
+    void setViewport(int width, int height) override;
+    void uploadTexture(GLuint texture, const TextureDesc& desc, const unsigned char* const* levels) override;
+    void deleteTexture(GLuint texture) override;
+    void draw(const DrawCall& call) override;
+    void beginOffscreen(int width, int height) override;
+    void endOffscreen() override;
+    void drawOffscreen() override;
+
+private:
+    struct Target {
+        std::vector<unsigned char> pixels;
+        int width = 0, height = 0;
+    };
+
+    enum class ShapeType {
+        Triangle,
+        GlyphTriangle,
+        Disc,
+        Timer,
+        Sprite
+    };
+
+    // Draw record transformed to pixels. Triangles use all three points, discs and timers the first as
+    // their center, sprites the first as the corner at UV min and the other two as the quad's edges.
+    struct Shape {
+        ShapeType type;
+        int minX, minY, maxX, maxY;
+        glm::vec2 points[3];
+        glm::vec4 colors[3];
+        glm::vec2 uvs[3];
+        float radius;
+        float progress;
+        const unsigned char* texels;
+        int textureWidth, textureHeight;
+        bool distanceField;
+    };
+
+    Target screen;
+    Target offscreen;
+    Target* target;
+    glm::vec2 viewportSize;
+
+    std::vector<Shape> shapes;
+    std::vector<std::vector<uint32_t>> tileBins;
+    int tilesX, tilesY;
+
+    TaskPool& pool;
+
+    glm::vec2 toPixels(const glm::vec2& position) const;
+    void bindTarget(Target& newTarget);
+    void clearTarget(Target& clearedTarget);
+    void addShape(Shape& shape);
+    void addTriangle(ShapeType type, const glm::vec2* positions, const glm::vec4* colors, const glm::vec2* uvs, const DrawCall& call);
+
+    void shadeTile(int tile);
+};
+
+#endif
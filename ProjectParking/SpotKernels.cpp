@@ -0,0 +1,162 @@
+#include "SpotKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPOT_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is compiled in on x86 and only picked when the CPU and the OS support it
+#if defined(SPOT_KERNELS_SSE2) && (defined(_MSC_VER) || defined(__GNUC__))
+#define SPOT_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+// GCC and Clang only emit AVX2 in functions marked for it, MSVC takes the intrinsics anywhere
+#ifdef __GNUC__
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+// Scalar lanes of a block, also the tail of the vector kernels
+static inline uint64_t compareSteps(const float* startTimes, const float* deadlines, const int32_t* drawnSteps, size_t first, size_t last, float now, int steps) {
+    uint64_t bits = 0;
+    for (size_t i = first; i < last; ++i) {
+        if (computeRingStep(startTimes[i], deadlines[i], now, steps) != drawnSteps[i]) {
+            bits |= 1ull << i;
+        }
+    }
+    return bits;
+}
+
+static void findRingRedrawsScalar(const float* startTimes, const float* deadlines, const int32_t* drawnSteps, size_t count, float now, int steps, uint64_t* redrawMask) {
+    for (size_t block = 0; block * 64 < count; ++block) {
+        size_t first = block * 64;
+        redrawMask[block] = compareSteps(startTimes + first, deadlines + first, drawnSteps + first, 0, std::min<size_t>(64, count - first), now, steps);
+    }
+}
+
+#ifdef SPOT_KERNELS_SSE2
+// Four spots at a time, the same operations in the same order as computeRingStep
+static void findRingRedrawsSSE2(const float* startTimes, const float* deadlines, const int32_t* drawnSteps, size_t count, float now, int steps, uint64_t* redrawMask) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 time = _mm_set1_ps(now);
+    const __m128 stepCount = _mm_set1_ps(static_cast<float>(steps));
+
+    for (size_t block = 0; block * 64 < count; ++block) {
+        size_t first = block * 64;
+        size_t length = std::min<size_t>(64, count - first);
+        const float* start = startTimes + first;
+        const float* deadline = deadlines + first;
+        const int32_t* drawn = drawnSteps + first;
+
+        uint64_t bits = 0;
+        size_t i = 0;
+        for (; i + 4 <= length; i += 4) {
+            __m128 startTime = _mm_loadu_ps(start + i);
+            __m128 duration = _mm_sub_ps(_mm_loadu_ps(deadline + i), startTime);
+            __m128 progress = _mm_div_ps(_mm_sub_ps(time, startTime), duration);
+            progress = _mm_and_ps(progress, _mm_cmpgt_ps(duration, zero));
+            progress = _mm_min_ps(_mm_max_ps(progress, zero), one);
+            __m128i step = _mm_cvttps_epi32(_mm_mul_ps(progress, stepCount));
+
+            __m128i same = _mm_cmpeq_epi32(step, _mm_loadu_si128(reinterpret_cast<const __m128i*>(drawn + i)));
+            uint64_t changed = static_cast<uint64_t>(~_mm_movemask_ps(_mm_castsi128_ps(same)) & 0xF);
+            bits |= changed << i;
+        }
+        bits |= compareSteps(start, deadline, drawn, i, length, now, steps);
+        redrawMask[block] = bits;
+    }
+}
+#endif
+
+#ifdef SPOT_KERNELS_AVX2
+// Eight spots at a time
+AVX2_TARGET static void findRingRedrawsAVX2(const float* startTimes, const float* deadlines, const int32_t* drawnSteps, size_t count, float now, int steps, uint64_t* redrawMask) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 time = _mm256_set1_ps(now);
+    const __m256 stepCount = _mm256_set1_ps(static_cast<float>(steps));
+
+    for (size_t block = 0; block * 64 < count; ++block) {
+        size_t first = block * 64;
+        size_t length = std::min<size_t>(64, count - first);
+        const float* start = startTimes + first;
+        const float* deadline = deadlines + first;
+        const int32_t* drawn = drawnSteps + first;
+
+        uint64_t bits = 0;
+        size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            __m256 startTime = _mm256_loadu_ps(start + i);
+            __m256 duration = _mm256_sub_ps(_mm256_loadu_ps(deadline + i), startTime);
+            __m256 progress = _mm256_div_ps(_mm256_sub_ps(time, startTime), duration);
+            progress = _mm256_and_ps(progress, _mm256_cmp_ps(duration, zero, _CMP_GT_OQ));
+            progress = _mm256_min_ps(_mm256_max_ps(progress, zero), one);
+            __m256i step = _mm256_cvttps_epi32(_mm256_mul_ps(progress, stepCount));
+
+            __m256i same = _mm256_cmpeq_epi32(step, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(drawn + i)));
+            uint64_t changed = static_cast<uint64_t>(~_mm256_movemask_ps(_mm256_castsi256_ps(same)) & 0xFF);
+            bits |= changed << i;
+        }
+        bits |= compareSteps(start, deadline, drawn, i, length, now, steps);
+        redrawMask[block] = bits;
+    }
+}
+#endif
+
+static bool isAvx2Supported() {
+#if defined(SPOT_KERNELS_AVX2) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    // The OS has to save the AVX registers too
+    bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    if (!osSavesAvx) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(SPOT_KERNELS_AVX2)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+SpotKernelLevel getSpotKernelLevel() {
+    static const SpotKernelLevel level = isAvx2Supported() ? SpotKernelLevel::AVX2
+#ifdef SPOT_KERNELS_SSE2
+        : SpotKernelLevel::SSE2;
+#else
+        : SpotKernelLevel::Scalar;
+#endif
+    return level;
+}
+
+// Levels that weren't compiled in fall back to the next one down
+RingStepKernel getRingStepKernel(SpotKernelLevel level) {
+#ifdef SPOT_KERNELS_AVX2
+    if (level == SpotKernelLevel::AVX2) {
+        return findRingRedrawsAVX2;
+    }
+#endif
+#ifdef SPOT_KERNELS_SSE2
+    if (level != SpotKernelLevel::Scalar) {
+        return findRingRedrawsSSE2;
+    }
+#endif
+    return findRingRedrawsScalar;
+}
+
+const char* getSpotKernelName(SpotKernelLevel level) {
+    switch (level) {
+    case SpotKernelLevel::AVX2:
+        return "AVX2";
+    case SpotKernelLevel::SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifndef SPOT_KERNELS_H
+#define SPOT_KERNELS_H
+
+// Step of the timer ring at the given time, from 0 up to steps once the deadline passed.
+// Free spots have no duration and stay at 0. Every kernel rounds exactly like this.
+inline int32_t computeRingStep(float startTime, float deadline, float now, int steps) {
+    float duration = deadline - startTime;
+    float progress = duration > 0.0f ? (now - startTime) / duration : 0.0f;
+    progress = std::min(std::max(progress, 0.0f), 1.0f);
+    return static_cast<int32_t>(progress * static_cast<float>(steps));
+}
+
+// Index of the lowest set bit, the bits must not be 0
+inline int findLowestBit(uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+enum class SpotKernelLevel {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Compares the ring step of count spots with the step they were drawn at. Bit i of the mask is set
+// when spot i has to be redrawn, a word per 64 spots, and every word the range touches is written.
+// Chunks must start at a multiple of 64 so they never share a word.
+typedef void (*RingStepKernel)(const float* startTimes, const float* deadlines, const int32_t* drawnSteps, size_t count, float now, int steps, uint64_t* redrawMask);
+
+// Best level the CPU supports, checked once
+SpotKernelLevel getSpotKernelLevel();
+RingStepKernel getRingStepKernel(SpotKernelLevel level);
+const char* getSpotKernelName(SpotKernelLevel level);
+
+#endif
@@ -0,0 +1,95 @@
+#include "SpotStore.h"
+#include "Profiler.h"
+#include <algorithm>
+
+SpotStore::SpotStore(size_t count) {
+    setKernelLevel(getSpotKernelLevel());
+    resize(count);
+}
+
+void SpotStore::resize(size_t count) {
+    flags.resize(count, TIMER_SOUND | BLINK_LIT);
+    startTimes.resize(count, 0.0f);
+    deadlines.resize(count, 0.0f);
+    drawnSteps.resize(count, 0);
+    details.resize(count);
+    expiries.resize(count);
+}
+
+void SpotStore::set(size_t spot, uint8_t flag, bool value) {
+    if (value) {
+        flags[spot] |= flag;
+    }
+    else {
+        flags[spot] &= ~flag;
+    }
+}
+
+void SpotStore::occupy(size_t spot, float now, float duration, const std::string& licensePlate, const std::string& driverName, const float carColor[3]) {
+    flags[spot] |= OCCUPIED | TIMER_SOUND;
+    renew(spot, now, duration);
+
+    SpotDetails& spotDetails = details[spot];
+    spotDetails.licensePlate = licensePlate;
+    spotDetails.driverName = driverName;
+    spotDetails.carColor[0] = carColor[0];
+    spotDetails.carColor[1] = carColor[1];
+    spotDetails.carColor[2] = carColor[2];
+}
+
+void SpotStore::renew(size_t spot, float now, float duration) {
+    startTimes[spot] = now;
+    deadlines[spot] = now + duration;
+    expiries.schedule(static_cast<uint32_t>(spot), deadlines[spot]);
+}
+
+void SpotStore::release(size_t spot) {
+    flags[spot] = (flags[spot] & BLINK_LIT) | TIMER_SOUND;
+    startTimes[spot] = 0.0f;
+    deadlines[spot] = 0.0f;
+    details[spot].licensePlate = "";
+    expiries.cancel(static_cast<uint32_t>(spot));
+}
+
+void SpotStore::collectExpired(float now, std::vector<uint32_t>& expired) {
+    expiries.advance(now, expired);
+}
+
+float SpotStore::getProgress(size_t spot, float now) const {
+    float duration = deadlines[spot] - startTimes[spot];
+    if (!has(spot, OCCUPIED) || duration <= 0.0f) {
+        return 0.0f;
+    }
+    return std::min(std::max((now - startTimes[spot]) / duration, 0.0f), 1.0f);
+}
+
+int32_t SpotStore::getRingStep(size_t spot, float now, int steps) const {
+    return computeRingStep(startTimes[spot], deadlines[spot], now, steps);
+}
+
+void SpotStore::findRingRedraws(float now, int steps, std::vector<uint64_t>& redrawMask, TaskPool* pool) const {
+    PROFILE_SCOPE("ring sweep");
+    size_t count = size();
+    redrawMask.resize((count + 63) / 64);
+
+    auto sweep = [this, now, steps, &redrawMask](size_t begin, size_t end) {
+        ringStepKernel(&startTimes[begin], &deadlines[begin], &drawnSteps[begin], end - begin, now, steps, &redrawMask[begin / 64]);
+    };
+    if (pool != nullptr) {
+        pool->parallelFor(count, SWEEP_CHUNK, sweep);
+    }
+    else if (count > 0) {
+        sweep(0, count);
+    }
+}
+
+void SpotStore::setKernelLevel(SpotKernelLevel level) {
+    kernelLevel = std::min(level, getSpotKernelLevel());
+    ringStepKernel = getRingStepKernel(kernelLevel);
+}
+
+void SpotStore::getBlinkColor(size_t spot, float color[3]) const {
+    color[0] = 1.0f;
+    color[1] = 0.0f;
+    color[2] = has(spot, BLINK_LIT) ? 1.0f : 0.0f;
+}
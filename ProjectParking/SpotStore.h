@@ -0,0 +1,93 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Rendering.h"
+#include "SpotKernels.h"
+#include "TaskPool.h"
+#include "TimerWheel.h"
+
+#ifndef SPOT_STORE_H
+#define SPOT_STORE_H
+
+// Per-spot data read only when the spot's geometry is rebuilt
+struct SpotDetails {
+    float carColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    std::string driverName;
+    std::string licensePlate;
+
+    // Cached text, rebuilt only when the strings change
+    Renderer::TextLayout labelLayout;
+    Renderer::TextLayout licensePlateLayout;
+    Renderer::TextLayout driverNameLayout;
+};
+
+// Parking spot state as parallel arrays indexed by spot: flags and times in hot arrays, strings, colors
+// and text layouts in the cold details table. Occupied spots are scheduled on a timer wheel by their
+// deadline, so finding the expired ones costs nothing for the spots that aren't due.
+// The timer rings move every frame on a full lot, they are swept with the SIMD kernel instead.
+// Times are in seconds on the caller's clock, which starts at 0.
+class SpotStore {
+public:
+    enum Flag : uint8_t {
+        OCCUPIED = 1 << 0,
+        BLINKING = 1 << 1,
+        // The expiry sound hasn't played yet
+        TIMER_SOUND = 1 << 2,
+        SHOW_INFO = 1 << 3,
+        // Blink light in its magenta phase, red otherwise
+        BLINK_LIT = 1 << 4
+    };
+
+    SpotStore(size_t count = 0);
+
+    void resize(size_t count);
+    size_t size() const { return flags.size(); }
+
+    bool has(size_t spot, uint8_t flag) const { return (flags[spot] & flag) != 0; }
+    void set(size_t spot, uint8_t flag, bool value);
+
+    // Parks a car that may stay for the given duration
+    void occupy(size_t spot, float now, float duration, const std::string& licensePlate, const std::string& driverName, const float carColor[3]);
+    // Restarts the time of an occupied spot, O(1)
+    void renew(size_t spot, float now, float duration);
+    // Frees the spot, the car details are dropped
+    void release(size_t spot);
+
+    // Appends the spots whose deadline passed since the last call
+    void collectExpired(float now, std::vector<uint32_t>& expired);
+    // Share of the time used up at the given time, 0..1, drives the red part of the timer ring
+    float getProgress(size_t spot, float now) const;
+    // Ring step of the spot at the given time, see computeRingStep
+    int32_t getRingStep(size_t spot, float now, int steps) const;
+    // Sets the bits of the spots whose ring step isn't the drawn one, a word per 64 spots.
+    // With a pool the sweep runs in parallel chunks.
+    void findRingRedraws(float now, int steps, std::vector<uint64_t>& redrawMask, TaskPool* pool = nullptr) const;
+    // Picks the sweep kernel, capped at the best one the CPU supports, which is also the default
+    void setKernelLevel(SpotKernelLevel level);
+    SpotKernelLevel getKernelLevel() const { return kernelLevel; }
+
+    // Color of the blink light for the indicator
+    void getBlinkColor(size_t spot, float color[3]) const;
+
+    // Hot
+    std::vector<uint8_t> flags;
+    std::vector<float> startTimes;
+    std::vector<float> deadlines;
+    // Ring step each spot was last drawn at
+    std::vector<int32_t> drawnSteps;
+
+    // Cold
+    std::vector<SpotDetails> details;
+
+private:
+    // Spots per parallel sweep chunk, a multiple of 64 so the chunks never share a mask word
+    static const size_t SWEEP_CHUNK = 16384;
+
+    SpotKernelLevel kernelLevel;
+    RingStepKernel ringStepKernel;
+
+    TimerWheel expiries;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "TaskPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <string>
+
+// The pool and worker index of the calling thread, -1 outside any pool
+static thread_local TaskPool* currentPool = nullptr;
+static thread_local int currentWorker = -1;
+
+TaskPool::TaskPool(int threadCount) : queued(0), nextWorker(0), stopping(false) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    for (int i = 1; i < threadCount; ++i) {
+        workers.emplace_back(new Worker());
+    }
+    // Started once the vector is complete, the workers steal from each other
+    for (int i = 0; i < static_cast<int>(workers.size()); ++i) {
+        workers[i]->thread = std::thread(&TaskPool::workerLoop, this, i);
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::unique_ptr<Worker>& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void TaskPool::submit(Task task) {
+    // Without workers the task runs right away
+    if (workers.empty()) {
+        task();
+        return;
+    }
+
+    int index = currentPool == this ? currentWorker : static_cast<int>(nextWorker++ % workers.size());
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // Counted under the sleep lock, so a worker about to sleep can't miss it
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued++;
+    }
+    wake.notify_one();
+}
+
+// Newest task of its own deque first, then the oldest of the others' starting with the next worker
+bool TaskPool::takeTask(int self, Task& task) {
+    int count = static_cast<int>(workers.size());
+    for (int offset = 0; offset < count; ++offset) {
+        Worker& worker = *workers[(self + offset) % count];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) {
+            continue;
+        }
+
+        if (offset == 0) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+        else {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void TaskPool::workerLoop(int index) {
+    currentPool = this;
+    currentWorker = index;
+    Profiler::setThreadName("worker " + std::to_string(index + 1));
+
+    for (;;) {
+        Task task;
+        if (takeTask(index, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
+
+void TaskPool::parallelFor(size_t count, size_t chunkSize, const RangeTask& body) {
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount <= 1 || workers.empty()) {
+        if (count > 0) {
+            body(0, count);
+        }
+        return;
+    }
+
+    // Chunks are claimed from a shared counter by every thread on the loop, so the caller never
+    // runs a task of someone else's and a helper that starts late just finds nothing left
+    struct Loop {
+        std::atomic<size_t> nextChunk;
+        std::atomic<size_t> doneChunks;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+    loop->nextChunk = 0;
+    loop->doneChunks = 0;
+
+    auto runChunks = [loop, chunkCount, chunkSize, count, &body]() {
+        for (size_t chunk = loop->nextChunk++; chunk < chunkCount; chunk = loop->nextChunk++) {
+            body(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+            if (++loop->doneChunks == chunkCount) {
+                std::lock_guard<std::mutex> lock(loop->mutex);
+                loop->done.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(workers.size(), chunkCount - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+        submit(runChunks);
+    }
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->done.wait(lock, [&]() { return loop->doneChunks == chunkCount; });
+}
@@ -0,0 +1,58 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops its own tasks at the back,
+// and when it runs dry it steals from the front of the others'. Tasks submitted from outside the pool
+// are dealt round-robin. Idle workers sleep until something is queued.
+class TaskPool {
+public:
+    typedef std::function<void()> Task;
+    // Gets the half-open range [begin, end) of a parallel loop
+    typedef std::function<void(size_t begin, size_t end)> RangeTask;
+
+    // A thread count of 0 uses one thread per hardware core. The threads calling parallelFor
+    // work on their loop as well, so the pool has one worker less than the thread count.
+    TaskPool(int threadCount = 0);
+    // Runs the tasks still queued, then joins the workers
+    ~TaskPool();
+
+    int getWorkerCount() const { return static_cast<int>(workers.size()); }
+
+    // Runs the task on a worker at some point, from a worker it goes to that worker's own deque
+    void submit(Task task);
+
+    // Splits [0, count) into chunks of chunkSize and runs them on the workers and the calling thread,
+    // returning when all are done. The chunks are the same whatever the thread count, so results
+    // kept per chunk can be merged in chunk order for output that doesn't depend on the scheduling.
+    void parallelFor(size_t count, size_t chunkSize, const RangeTask& body);
+
+private:
+    struct Worker {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    // Tasks in the deques, not yet taken by a worker
+    std::atomic<int> queued;
+    std::atomic<unsigned int> nextWorker;
+    bool stopping;
+
+    bool takeTask(int self, Task& task);
+    void workerLoop(int index);
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "TextureCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+// The decoder is compiled once, here where the images are decoded
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+static const char CACHE_MAGIC[4] = { 'P', 'T', 'X', 'C' };
+// Level data starts on this boundary so the rows can be uploaded straight from the mapping
+static const size_t LEVEL_ALIGNMENT = 16;
+
+static size_t levelSize(int width, int height, int level) {
+    return static_cast<size_t>(std::max(1, width >> level)) * std::max(1, height >> level) * 4;
+}
+
+static size_t alignUp(size_t value) {
+    return (value + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1);
+}
+
+BakedTexture::BakedTexture() : width(0), height(0), levelCount(0), cached(false), sourceSize(0), sourceTime(0) {
+    std::fill(levels, levels + MAX_LEVELS, nullptr);
+}
+
+std::string BakedTexture::getCachePath(const std::string& sourcePath) {
+    return sourcePath + ".texcache";
+}
+
+static bool getFileStamp(const std::string& path, uint64_t& size, int64_t& time) {
+#ifdef _WIN32
+    struct _stat64 info;
+    if (_stat64(path.c_str(), &info) != 0) {
+        return false;
+    }
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+#endif
+    size = static_cast<uint64_t>(info.st_size);
+    time = static_cast<int64_t>(info.st_mtime);
+    return true;
+}
+
+bool BakedTexture::load(const std::string& sourcePath) {
+    uint64_t size;
+    int64_t time;
+    if (!getFileStamp(sourcePath, size, time)) {
+        std::cerr << "ERROR::TEXTURE_CACHE: Source image not found: " << sourcePath << std::endl;
+        return false;
+    }
+
+    std::string cachePath = getCachePath(sourcePath);
+    if (loadCache(cachePath) && sourceSize == size && sourceTime == time) {
+        return true;
+    }
+    mapping.close();
+
+    if (!bake(sourcePath)) {
+        return false;
+    }
+    sourceSize = size;
+    sourceTime = time;
+    writeCache(cachePath);
+    return true;
+}
+
+bool BakedTexture::loadFromMemory(const unsigned char* data, size_t size) {
+    return parse(data, size);
+}
+
+bool BakedTexture::parse(const unsigned char* data, size_t size) {
+    const TextureCacheHeader* header = reinterpret_cast<const TextureCacheHeader*>(data);
+    bool valid = size >= sizeof(TextureCacheHeader) &&
+        memcmp(header->magic, CACHE_MAGIC, 4) == 0 &&
+        header->version == VERSION &&
+        header->levelCount >= 1 && header->levelCount <= MAX_LEVELS;
+
+    // Every level has to lie inside the data, a truncated cache counts as stale
+    for (uint32_t level = 0; valid && level < header->levelCount; ++level) {
+        valid = header->levelOffsets[level] + levelSize(header->width, header->height, level) <= size;
+    }
+
+    if (!valid) {
+        return false;
+    }
+
+    width = header->width;
+    height = header->height;
+    levelCount = header->levelCount;
+    sourceSize = header->sourceSize;
+    sourceTime = header->sourceTime;
+    for (int level = 0; level < levelCount; ++level) {
+        levels[level] = data + header->levelOffsets[level];
+    }
+    cached = true;
+    return true;
+}
+
+bool BakedTexture::loadCache(const std::string& cachePath) {
+    return mapping.open(cachePath) && parse(mapping.getData(), mapping.getSize());
+}
+
+bool BakedTexture::bake(const std::string& sourcePath) {
+    int channels;
+    unsigned char* decoded = stbi_load(sourcePath.c_str(), &width, &height, &channels, 4);
+    if (!decoded) {
+        std::cerr << "ERROR::TEXTURE_CACHE: Failed to decode image: " << sourcePath << std::endl;
+        return false;
+    }
+
+    // Full chain down to 1x1, the same sizes glGenerateMipmap would produce
+    levelCount = 1;
+    while (levelCount < MAX_LEVELS && (width >> levelCount > 0 || height >> levelCount > 0)) {
+        levelCount++;
+    }
+
+    size_t offsets[MAX_LEVELS];
+    size_t total = 0;
+    for (int level = 0; level < levelCount; ++level) {
+        offsets[level] = total;
+        total = alignUp(total + levelSize(width, height, level));
+    }
+
+    pixels.resize(total);
+    memcpy(&pixels[0], decoded, levelSize(width, height, 0));
+    stbi_image_free(decoded);
+
+    // 2x2 box filter, odd edges repeat their last row or column
+    for (int level = 1; level < levelCount; ++level) {
+        const unsigned char* src = &pixels[offsets[level - 1]];
+        unsigned char* dst = &pixels[offsets[level]];
+        int srcWidth = std::max(1, width >> (level - 1));
+        int srcHeight = std::max(1, height >> (level - 1));
+        int dstWidth = std::max(1, width >> level);
+        int dstHeight = std::max(1, height >> level);
+
+        for (int y = 0; y < dstHeight; ++y) {
+            int y0 = std::min(y * 2, srcHeight - 1);
+            int y1 = std::min(y * 2 + 1, srcHeight - 1);
+            for (int x = 0; x < dstWidth; ++x) {
+                int x0 = std::min(x * 2, srcWidth - 1);
+                int x1 = std::min(x * 2 + 1, srcWidth - 1);
+                for (int c = 0; c < 4; ++c) {
+                    int sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c] +
+                        src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c];
+                    dst[(y * dstWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+
+    for (int level = 0; level < levelCount; ++level) {
+        levels[level] = &pixels[offsets[level]];
+    }
+    cached = false;
+    return true;
+}
+
+bool BakedTexture::write(std::ostream& out) const {
+    TextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = VERSION;
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    header.width = width;
+    header.height = height;
+    header.levelCount = levelCount;
+
+    // Levels are written back to back on aligned offsets, whether they are owned or mapped
+    size_t offset = alignUp(sizeof(TextureCacheHeader));
+    for (int level = 0; level < levelCount; ++level) {
+        header.levelOffsets[level] = offset;
+        offset = alignUp(offset + levelSize(width, height, level));
+    }
+
+    static const char zeros[LEVEL_ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    size_t written = sizeof(header);
+    for (int level = 0; level < levelCount; ++level) {
+        out.write(zeros, header.levelOffsets[level] - written);
+        out.write(reinterpret_cast<const char*>(levels[level]), levelSize(width, height, level));
+        written = header.levelOffsets[level] + levelSize(width, height, level);
+    }
+    out.write(zeros, offset - written);
+    return !out.fail();
+}
+
+void BakedTexture::writeCache(const std::string& cachePath) const {
+    // Written under a temporary name so a crash never leaves a half-written cache behind
+    std::string tempPath = cachePath + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return;
+    }
+
+    bool written = write(file);
+    file.close();
+    written = written && !file.fail();
+
+    remove(cachePath.c_str());
+    if (!written || rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "ERROR::TEXTURE_CACHE: Failed to write " << cachePath << std::endl;
+        remove(tempPath.c_str());
+    }
+}
@@ -0,0 +1,64 @@
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+// On-disk layout of a baked texture: the header, then the RGBA8 mip levels at the given offsets
+struct TextureCacheHeader {
+    char magic[4];
+    uint32_t version;
+    // Size and modification time of the source image, the cache is stale when they differ
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint32_t width, height;
+    uint32_t levelCount;
+    uint32_t reserved;
+    uint64_t levelOffsets[16];
+};
+
+// Decoded RGBA image with its whole mip chain. The levels point into the mapped cache file when it
+// was up to date, otherwise the source is decoded, mipmapped on the CPU and the cache is rewritten.
+class BakedTexture {
+public:
+    static const int MAX_LEVELS = 16;
+    static const uint32_t VERSION = 1;
+
+    BakedTexture();
+
+    bool load(const std::string& sourcePath);
+    // Uses a baked texture already in memory, the data has to outlive this object
+    bool loadFromMemory(const unsigned char* data, size_t size);
+    // Writes the header and the levels in the cache layout
+    bool write(std::ostream& out) const;
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getLevelCount() const { return levelCount; }
+    const unsigned char* const* getLevels() const { return levels; }
+    // True when the levels came from the cache instead of the source image
+    bool isFromCache() const { return cached; }
+
+    static std::string getCachePath(const std::string& sourcePath);
+
+private:
+    int width, height;
+    int levelCount;
+    const unsigned char* levels[MAX_LEVELS];
+    bool cached;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+
+    MappedFile mapping;
+    std::vector<unsigned char> pixels;
+
+    bool parse(const unsigned char* data, size_t size);
+    bool loadCache(const std::string& cachePath);
+    bool bake(const std::string& sourcePath);
+    void writeCache(const std::string& cachePath) const;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "TimerWheel.h"
+#include <algorithm>
+#include <cmath>
+
+TimerWheel::TimerWheel(double tickSeconds) : tickSeconds(tickSeconds), currentTick(0), slotHeads(SLOT_COUNT, NO_NODE) {
+}
+
+void TimerWheel::resize(size_t count) {
+    for (size_t id = count; id < nodes.size(); ++id) {
+        cancel(static_cast<uint32_t>(id));
+    }
+    nodes.resize(count);
+}
+
+void TimerWheel::schedule(uint32_t id, double deadline) {
+    unlink(id);
+    double ticks = std::ceil(deadline / tickSeconds);
+    nodes[id].tick = ticks > static_cast<double>(currentTick) ? static_cast<uint64_t>(ticks) : currentTick;
+    link(id);
+}
+
+void TimerWheel::cancel(uint32_t id) {
+    unlink(id);
+}
+
+// Picks the level by how far away the tick is, and the slot within it by the tick's bits at that level
+void TimerWheel::link(uint32_t id) {
+    Node& node = nodes[id];
+    uint64_t delta = node.tick - currentTick;
+
+    uint32_t slot;
+    if (delta < FIRST_LEVEL_SLOTS) {
+        slot = static_cast<uint32_t>(node.tick & (FIRST_LEVEL_SLOTS - 1));
+    }
+    else {
+        int level = 1;
+        int shift = FIRST_LEVEL_BITS;
+        while (level < LEVEL_COUNT - 1 && delta >= (1ull << (shift + LEVEL_BITS))) {
+            level++;
+            shift += LEVEL_BITS;
+        }
+        uint64_t tick = node.tick;
+        if (delta >= (1ull << (shift + LEVEL_BITS))) {
+            // Beyond the wheel, parked in the furthest slot until it cascades
+            tick = currentTick + (1ull << (shift + LEVEL_BITS)) - 1;
+        }
+        slot = FIRST_LEVEL_SLOTS + (level - 1) * LEVEL_SLOTS + static_cast<uint32_t>((tick >> shift) & (LEVEL_SLOTS - 1));
+    }
+
+    node.slot = slot;
+    node.previous = NO_NODE;
+    node.next = slotHeads[slot];
+    if (node.next != NO_NODE) {
+        nodes[node.next].previous = id;
+    }
+    slotHeads[slot] = id;
+}
+
+void TimerWheel::unlink(uint32_t id) {
+    Node& node = nodes[id];
+    if (node.slot == NO_SLOT) {
+        return;
+    }
+
+    if (node.previous != NO_NODE) {
+        nodes[node.previous].next = node.next;
+    }
+    else {
+        slotHeads[node.slot] = node.next;
+    }
+    if (node.next != NO_NODE) {
+        nodes[node.next].previous = node.previous;
+    }
+    node.previous = NO_NODE;
+    node.next = NO_NODE;
+    node.slot = NO_SLOT;
+}
+
+// Moves the timers of the level's current slot down, the level below has just wrapped around
+void TimerWheel::cascade(int level) {
+    int shift = FIRST_LEVEL_BITS + (level - 1) * LEVEL_BITS;
+    uint32_t slot = FIRST_LEVEL_SLOTS + (level - 1) * LEVEL_SLOTS + static_cast<uint32_t>((currentTick >> shift) & (LEVEL_SLOTS - 1));
+
+    uint32_t id = slotHeads[slot];
+    slotHeads[slot] = NO_NODE;
+    while (id != NO_NODE) {
+        uint32_t next = nodes[id].next;
+        nodes[id].slot = NO_SLOT;
+        link(id);
+        id = next;
+    }
+}
+
+void TimerWheel::advance(double now, std::vector<uint32_t>& expired) {
+    double target = std::floor(now / tickSeconds);
+    if (target < static_cast<double>(currentTick)) {
+        return;
+    }
+    uint64_t lastTick = static_cast<uint64_t>(target);
+
+    for (; currentTick <= lastTick; ++currentTick) {
+        // Each level cascades when every level below it has wrapped around
+        int shift = FIRST_LEVEL_BITS;
+        for (int level = 1; level < LEVEL_COUNT; ++level) {
+            if ((currentTick & ((1ull << shift) - 1)) != 0) {
+                break;
+            }
+            cascade(level);
+            shift += LEVEL_BITS;
+        }
+
+        uint32_t slot = static_cast<uint32_t>(currentTick & (FIRST_LEVEL_SLOTS - 1));
+        uint32_t id = slotHeads[slot];
+        slotHeads[slot] = NO_NODE;
+        while (id != NO_NODE) {
+            uint32_t next = nodes[id].next;
+            nodes[id].previous = NO_NODE;
+            nodes[id].next = NO_NODE;
+            nodes[id].slot = NO_SLOT;
+            expired.push_back(id);
+            id = next;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+// Hierarchical timing wheel over a fixed set of ids, each with at most one pending deadline.
+// Scheduling, rescheduling and cancelling are O(1): a timer sits in a doubly linked slot list,
+// and advancing only visits the slots that come due. The first level holds the next 256 ticks,
+// each level above covers 64 slots of the whole level below, and timers cascade down as their
+// time comes closer. Deadlines past the top level wait in its last slot and cascade again.
+class TimerWheel {
+public:
+    // Time starts at 0, the first advance walks every tick up to its time.
+    // Deadlines are rounded up to whole ticks, so a timer fires at most one tick late, never early.
+    TimerWheel(double tickSeconds = 0.01);
+
+    // Ids run from 0 to count - 1, new ones start unscheduled
+    void resize(size_t count);
+    size_t size() const { return nodes.size(); }
+
+    // Replaces any deadline the id already had. A deadline in the past fires on the next advance.
+    void schedule(uint32_t id, double deadline);
+    void cancel(uint32_t id);
+    bool isScheduled(uint32_t id) const { return nodes[id].slot != NO_SLOT; }
+
+    // Appends the ids due at the given time, earliest tick first, and unschedules them
+    void advance(double now, std::vector<uint32_t>& expired);
+
+private:
+    static const int FIRST_LEVEL_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVEL_COUNT = 4;
+    static const int FIRST_LEVEL_SLOTS = 1 << FIRST_LEVEL_BITS;
+    static const int LEVEL_SLOTS = 1 << LEVEL_BITS;
+    static const int SLOT_COUNT = FIRST_LEVEL_SLOTS + (LEVEL_COUNT - 1) * LEVEL_SLOTS;
+    static const uint32_t NO_SLOT = UINT32_MAX;
+    static const uint32_t NO_NODE = UINT32_MAX;
+
+    struct Node {
+        uint32_t previous = NO_NODE;
+        uint32_t next = NO_NODE;
+        uint32_t slot = NO_SLOT;
+        uint64_t tick = 0;
+    };
+
+    double tickSeconds;
+    // Next tick to be processed
+    uint64_t currentTick;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> slotHeads;
+
+    void link(uint32_t id);
+    void unlink(uint32_t id);
+    void cascade(int level);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include <cstring>
+#include <iostream>
+#include <map>
+#include "RecordingBackend.h"
+#include "Rendering.h"
+
+// Rewrites the slots of a large rectangle layer the way the scene does: emptied in a block, grown past
+// their range, shrunk again. The drawn records have to be exactly the rectangles of the slots, once each,
+// with the large holes left out of the draws.
+
+static const int SLOTS = 10000;
+
+// Rectangles of the given slots, one at x = slot and a second at x = slot + 0.5 for the grown ones
+static void writeSlots(Renderer& renderer, int layer, int first, int end, int rectangles) {
+    const float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int slot = first; slot < end; ++slot) {
+        renderer.beginLayerSlot(layer, slot);
+        for (int i = 0; i < rectangles; ++i) {
+            renderer.submitRectangle(slot + 0.5f * i, 0.0f, 1.0f, 1.0f, color);
+        }
+        renderer.endLayerSlot();
+    }
+}
+
+static bool check(const char* name, Renderer& renderer, RecordingBackend& backend, int layer, size_t drawCalls, const std::map<float, int>& expected) {
+    renderer.beginFrame();
+    renderer.drawLayer(layer);
+
+    // Zeroed rectangles are degenerate, the others are counted by their first corner
+    std::map<float, int> drawn;
+    size_t draws = 0;
+    for (const RecordedCommand& command : backend.getCommands()) {
+        if (command.type != RecordedCommandType::Draw) {
+            continue;
+        }
+        draws++;
+        const std::vector<unsigned char>& data = backend.getBufferData(command.call.buffer);
+        for (GLsizei vertex = 0; vertex < command.call.count; vertex += 6) {
+            ColorVertex corner;
+            memcpy(&corner, data.data() + command.call.offset + vertex * sizeof(ColorVertex), sizeof(ColorVertex));
+            if (corner.a != 0.0f) {
+                drawn[corner.x]++;
+            }
+        }
+    }
+
+    if (draws != drawCalls || drawn != expected) {
+        std::cerr << "ERROR::RETAINED_LAYER_TEST: " << name << ": " << draws << " draws of " << drawn.size()
+            << " rectangles, expected " << drawCalls << " draws of " << expected.size() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    RecordingBackend backend;
+    Renderer renderer(backend, 1400, 800);
+    int layer = renderer.createLayer(Renderer::Primitive::Rectangle, SLOTS);
+
+    std::map<float, int> expected;
+    for (int slot = 0; slot < SLOTS; ++slot) {
+        expected[static_cast<float>(slot)] = 1;
+    }
+    bool passed = true;
+    writeSlots(renderer, layer, 0, SLOTS, 1);
+    passed = check("filled", renderer, backend, layer, 1, expected) && passed;
+
+    // A block of empty slots is a hole too big to draw, the layer is drawn around it
+    writeSlots(renderer, layer, 1000, 3000, 0);
+    for (int slot = 1000; slot < 3000; ++slot) {
+        expected.erase(static_cast<float>(slot));
+    }
+    passed = check("emptied", renderer, backend, layer, 2, expected) && passed;
+
+    // Grown slots move to the end, and once the holes make up a quarter of the layer it is packed again
+    writeSlots(renderer, layer, 5000, 6000, 2);
+    for (int slot = 5000; slot < 6000; ++slot) {
+        expected[slot + 0.5f] = 1;
+    }
+    passed = check("grown", renderer, backend, layer, 1, expected) && passed;
+
+    // The grown slots were packed last, emptying the ones before them leaves a hole in the middle again
+    writeSlots(renderer, layer, 5000, 6000, 1);
+    writeSlots(renderer, layer, 9000, SLOTS, 0);
+    for (int slot = 5000; slot < 6000; ++slot) {
+        expected.erase(slot + 0.5f);
+    }
+    for (int slot = 9000; slot < SLOTS; ++slot) {
+        expected.erase(static_cast<float>(slot));
+    }
+    passed = check("shrunk", renderer, backend, layer, 2, expected) && passed;
+
+    // Emptying the last slots gives their records back along with the hole in front of them
+    writeSlots(renderer, layer, 5000, 6000, 0);
+    for (int slot = 5000; slot < 6000; ++slot) {
+        expected.erase(static_cast<float>(slot));
+    }
+    passed = check("released", renderer, backend, layer, 1, expected) && passed;
+
+    if (passed) {
+        std::cout << "RetainedLayerTest passed" << std::endl;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "Rendering.h"
+#include "SoftwareBackend.h"
+#include "TaskPool.h"
+
+// Rasterizes text and a sprite on the software backend near the window origin and again near the far
+// corner, where float error in the interpolation is largest. The far copies have to match the near ones
+// pixel for pixel, and the sprite's texels have to land in the right quadrants.
+
+static const int WIDTH = 1400;
+static const int HEIGHT = 800;
+// Far copies are shifted by whole pixels, so they sample the same texels as the near ones
+static const int SHIFT_X = 1136;
+static const int SHIFT_Y = 690;
+static const int TOLERANCE = 8;
+
+static const unsigned char* pixelAt(SoftwareBackend& backend, int x, int y) {
+    return &backend.getFramebuffer()[(static_cast<size_t>(y) * WIDTH + x) * 4];
+}
+
+static bool sameBlock(SoftwareBackend& backend, const char* name, int x, int y, int width, int height) {
+    int differing = 0;
+    for (int row = y; row < y + height; ++row) {
+        for (int column = x; column < x + width; ++column) {
+            const unsigned char* near = pixelAt(backend, column, row);
+            const unsigned char* far = pixelAt(backend, column + SHIFT_X, row + SHIFT_Y);
+            for (int channel = 0; channel < 3; ++channel) {
+                if (std::abs(near[channel] - far[channel]) > TOLERANCE) {
+                    differing++;
+                    break;
+                }
+            }
+        }
+    }
+    if (differing > 0) {
+        std::cerr << "ERROR::SOFTWARE_RENDER_TEST: " << name << ": " << differing << " pixels differ near the far corner" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool checkColor(SoftwareBackend& backend, const char* name, int x, int y, const unsigned char expected[3]) {
+    const unsigned char* pixel = pixelAt(backend, x, y);
+    for (int channel = 0; channel < 3; ++channel) {
+        if (std::abs(pixel[channel] - expected[channel]) > TOLERANCE) {
+            std::cerr << "ERROR::SOFTWARE_RENDER_TEST: " << name << " at " << x << ", " << y << " is " << static_cast<int>(pixel[0]) << " "
+                << static_cast<int>(pixel[1]) << " " << static_cast<int>(pixel[2]) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    TaskPool pool(1);
+    SoftwareBackend backend(pool);
+    Renderer renderer(backend, WIDTH, HEIGHT, Renderer::FontMode::SignedDistanceField);
+    renderer.setViewport(WIDTH, HEIGHT);
+    renderer.setClearColor(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    renderer.setProjectionMatrix(glm::ortho(0.0f, static_cast<float>(WIDTH), 0.0f, static_cast<float>(HEIGHT)));
+
+    // Quadrants of red, green, blue and grey, none near white so the blend color stays out
+    const unsigned char texels[16] = {
+        255, 0, 0, 255,    0, 255, 0, 255,
+        0, 0, 255, 255,    96, 96, 96, 255
+    };
+    const unsigned char* levels[1] = { texels };
+    TextureDesc desc = { TextureFormat::RGBA, 2, 2, 1, 0, true };
+    TextureRegion region(backend.createTexture());
+    backend.uploadTexture(region.texture, desc, levels);
+
+    const std::string text = "Vuk Dimitrov SV52/2021";
+    const float scale = 0.5f;
+    const glm::vec4 white(1.0f, 1.0f, 1.0f, 1.0f);
+    const int textWidth = static_cast<int>(renderer.measureTextWidth(text, scale)) + 1;
+
+    renderer.beginFrame();
+    renderer.drawText(text, 5.0f, 40.0f, scale, white);
+    renderer.drawText(text, 5.0f + SHIFT_X, 40.0f + SHIFT_Y, scale, white);
+    renderer.renderImage(region, 10.0f, 10.0f, 80.0f, 80.0f, 0.0f, 1.0f, glm::vec3(1.0f));
+    renderer.renderImage(region, 10.0f + SHIFT_X, 10.0f + SHIFT_Y, 80.0f, 80.0f, 0.0f, 1.0f, glm::vec3(1.0f));
+    backend.finish();
+
+    // The text has to have been drawn at all, or matching copies prove nothing
+    int textPixels = 0;
+    for (int y = 30; y < 100; ++y) {
+        for (int x = 0; x < textWidth + 10; ++x) {
+            textPixels += pixelAt(backend, x, y)[0] > 128 ? 1 : 0;
+        }
+    }
+    bool passed = true;
+    if (textPixels < 200) {
+        std::cerr << "ERROR::SOFTWARE_RENDER_TEST: only " << textPixels << " text pixels drawn" << std::endl;
+        passed = false;
+    }
+
+    passed = sameBlock(backend, "text", 0, 30, textWidth + 10, 70) && passed;
+    passed = sameBlock(backend, "sprite", 10, 10, 80, 80) && passed;
+
+    // The first texel row is the bottom of the sprite
+    const unsigned char red[3] = { 255, 0, 0 };
+    const unsigned char green[3] = { 0, 255, 0 };
+    const unsigned char blue[3] = { 0, 0, 255 };
+    const unsigned char grey[3] = { 96, 96, 96 };
+    passed = checkColor(backend, "lower left texel", 1166, 720, red) && passed;
+    passed = checkColor(backend, "lower right texel", 1206, 720, green) && passed;
+    passed = checkColor(backend, "upper left texel", 1166, 760, blue) && passed;
+    passed = checkColor(backend, "upper right texel", 1206, 760, grey) && passed;
+
+    if (passed) {
+        std::cout << "SoftwareRenderTest passed" << std::endl;
+    }
+    return passed ? 0 : 1;
+}
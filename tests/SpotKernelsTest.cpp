@@ -0,0 +1,97 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "SpotKernels.h"
+#include "SpotStore.h"
+
+// Runs every ring step kernel the CPU supports on the same spots and compares the masks with the scalar kernel.
+// The spots cover free ones, ones before their start, on a step boundary and past their deadline, and the
+// lengths leave tails of every size behind the vector lanes.
+
+struct SweepInput {
+    std::vector<float> startTimes;
+    std::vector<float> deadlines;
+    std::vector<int32_t> drawnSteps;
+};
+
+static const int STEPS = 512;
+static const float NOW = 100.0f;
+
+static SweepInput makeInput(size_t count) {
+    SweepInput input;
+    for (size_t i = 0; i < count; ++i) {
+        float start = NOW - static_cast<float>(rand() % 4000) / 100.0f;
+        float duration = static_cast<float>(rand() % 3000) / 100.0f;
+        switch (i % 5) {
+        case 0:
+            // Free
+            start = 0.0f;
+            duration = 0.0f;
+            break;
+        case 1:
+            // Exactly on a step
+            duration = 20.0f;
+            start = NOW - duration * static_cast<float>(rand() % STEPS) / STEPS;
+            break;
+        case 2:
+            // Not started yet
+            start = NOW + 1.0f;
+            break;
+        }
+        input.startTimes.push_back(start);
+        input.deadlines.push_back(start + duration);
+
+        // Most spots are drawn at their current step, the others one step behind or never drawn
+        int32_t step = computeRingStep(start, start + duration, NOW, STEPS);
+        input.drawnSteps.push_back(rand() % 3 == 0 ? step - 1 : rand() % 7 == 0 ? 0 : step);
+    }
+    return input;
+}
+
+static std::vector<uint64_t> sweep(SpotKernelLevel level, const SweepInput& input) {
+    std::vector<uint64_t> mask((input.startTimes.size() + 63) / 64, ~0ull);
+    getRingStepKernel(level)(input.startTimes.data(), input.deadlines.data(), input.drawnSteps.data(), input.startTimes.size(), NOW, STEPS, mask.data());
+    return mask;
+}
+
+int main() {
+    srand(1);
+    bool passed = true;
+    const size_t counts[] = { 1, 3, 4, 7, 8, 9, 63, 64, 65, 127, 1000, 100003 };
+    for (size_t count : counts) {
+        SweepInput input = makeInput(count);
+        std::vector<uint64_t> expected = sweep(SpotKernelLevel::Scalar, input);
+
+        // The scalar mask has to match a spot by spot check too
+        for (size_t i = 0; i < count; ++i) {
+            bool changed = computeRingStep(input.startTimes[i], input.deadlines[i], NOW, STEPS) != input.drawnSteps[i];
+            if (changed != (((expected[i / 64] >> (i % 64)) & 1) != 0)) {
+                std::cerr << "ERROR::SPOT_KERNELS_TEST: scalar kernel, " << count << " spots: wrong bit for spot " << i << std::endl;
+                passed = false;
+                break;
+            }
+        }
+
+        for (int level = static_cast<int>(SpotKernelLevel::SSE2); level <= static_cast<int>(getSpotKernelLevel()); ++level) {
+            SpotKernelLevel kernelLevel = static_cast<SpotKernelLevel>(level);
+            if (sweep(kernelLevel, input) != expected) {
+                std::cerr << "ERROR::SPOT_KERNELS_TEST: " << getSpotKernelName(kernelLevel) << " kernel differs from the scalar one for "
+                    << count << " spots" << std::endl;
+                passed = false;
+            }
+        }
+    }
+
+    // Levels above what the CPU supports are capped, never run
+    SpotStore store;
+    store.setKernelLevel(SpotKernelLevel::AVX2);
+    if (store.getKernelLevel() != getSpotKernelLevel()) {
+        std::cerr << "ERROR::SPOT_KERNELS_TEST: AVX2 was not capped at " << getSpotKernelName(getSpotKernelLevel()) << std::endl;
+        passed = false;
+    }
+
+    if (passed) {
+        std::cout << "SpotKernelsTest passed, kernels up to " << getSpotKernelName(getSpotKernelLevel()) << std::endl;
+    }
+    return passed ? 0 : 1;
+}